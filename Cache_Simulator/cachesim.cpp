@@ -0,0 +1,4 @@
+// the generic engine of cachesim.hpp compiled once for libcachesim.a
+#include "cachesim.hpp"
+
+template class Simulator<Cache<>>;
@@ -0,0 +1,2946 @@
+#ifndef __CACHESIM_HPP__
+#define __CACHESIM_HPP__
+
+// libcachesim : the quad core L1 cache and MESI bus model behind L1simulate
+// everything is in this header , a program can build a Simulator , push accesses into it from memory ,
+// step() it cycle by cycle or run() it to the end and read the CoreStats of every core with core_stats()
+//
+//     Simulator<> sim(6, 2, 5);
+//     sim.push_access(0, false, 0x1000);
+//     sim.run();
+//     uint64_t misses = sim.core_stats(0).miss_count;
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <queue>
+#include <deque>
+#include <map>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <cstdlib>
+
+// thsi is to describe the states 
+
+enum class MESIState { INVALID, SHARED, EXCLUSIVE, MODIFIED };
+// this is to update the bus opertion 
+// BUS_UPDATE broadcasts one written word to the other copies under the update protocols , BUS_WRITE posts written
+// bytes to memory and invalidates the other copies , NONE is no transaction
+enum class BusOperation { BUS_READ, BUS_READX, BUS_UPDATE, INVALIDATE, FLUSH, BUS_WRITE, NONE };
+// these are the ways of turning a block address into a set index
+// MODULO is the usual low bits , XOR_FOLD xors the tag bits into them , PRIME_MODULO takes the block modulo the
+// largest prime not above the number of sets and SKEWED uses a different hash for every way
+enum class IndexMode { MODULO, XOR_FOLD, PRIME_MODULO, SKEWED };
+// how a private L2 relates to the L1 above it , INCLUSIVE holds every L1 block and takes them back from the L1 when it
+// evicts them , EXCLUSIVE only holds what the L1 evicted and NINE (non-inclusive non-exclusive) is filled with the L1
+// but evicts on its own
+enum class InclusionPolicy { INCLUSIVE, EXCLUSIVE, NINE };
+// what a snoop did to the copy of one cache , MISSED if it had none , KEPT if some of it is still there
+enum class SnoopResult { MISSED, KEPT, INVALIDATED };
+// MESI invalidates the other copies on a write , DRAGON and FIREFLY update them with the written word instead
+// Dragon's shared modified owner is a SHARED line with its dirty bit set , Firefly writes the word through to memory so
+// its SHARED lines are always clean
+enum class CoherenceProtocol { MESI, DRAGON, FIREFLY };
+// what a trace access does besides its read or write , A lines are atomic read modify writes that hold their line for
+// the lock latency and L and S lines are load reserved and store conditional
+enum class AccessKind : uint8_t { PLAIN, RMW, LOAD_RESERVED, STORE_CONDITIONAL };
+// which socket's memory a page lives in , INTERLEAVE deals the pages out in turn and FIRST_TOUCH gives a page to the
+// socket of the first core that misses on it
+enum class HomePolicy { INTERLEAVE, FIRST_TOUCH };
+
+
+inline const char* index_mode_name(IndexMode mode) {
+    switch (mode) {
+        case IndexMode::XOR_FOLD: return "xor";
+        case IndexMode::PRIME_MODULO: return "prime";
+        case IndexMode::SKEWED: return "skewed";
+        default: return "modulo";
+    }
+}
+
+inline const char* protocol_name(CoherenceProtocol protocol) {
+    switch (protocol) {
+        case CoherenceProtocol::DRAGON: return "dragon";
+        case CoherenceProtocol::FIREFLY: return "firefly";
+        default: return "mesi";
+    }
+}
+
+inline const char* home_policy_name(HomePolicy policy) {
+    return policy == HomePolicy::FIRST_TOUCH ? "first-touch" : "interleave";
+}
+
+inline const char* inclusion_policy_name(InclusionPolicy policy) {
+    switch (policy) {
+        case InclusionPolicy::EXCLUSIVE: return "exclusive";
+        case InclusionPolicy::NINE: return "nine";
+        default: return "inclusive";
+    }
+}
+
+
+// this is the struct defining elemsents for each cache line
+// tag only holds the low 32 bits of the tag , the bits above are kept once per cache in a TagRegionTable and
+// tag_region is the id of this line's entry there , it sits in padding so the line is no bigger than with 32 bit tags
+struct CacheLine {
+    uint32_t tag;
+    bool valid;
+    bool dirty;
+    uint16_t tag_region = 0;
+    MESIState state;
+    uint32_t lru_counter;
+    std::vector<uint8_t> data;
+};
+
+
+// this is the parameetrs for a bus transaction which is updated after snooping adn my instruction is processed accordingly 
+struct BusTransaction {
+    BusOperation operation;
+    uint64_t address;
+    int originating_core;
+    int remaining_cycles;
+    // a write miss under an update protocol goes out as a BUS_READ and broadcasts its word once the block is there
+    bool write_miss = false;
+    // the shared line , raised by every cache that still holds the block when it snoops a BUS_UPDATE
+    bool shared = false;
+    // the bytes a BUS_WRITE posts , and if it empties a write combining entry instead of carrying an access of its own
+    uint32_t bytes = 0;
+    bool drain = false;
+    std::vector<uint8_t> data;
+    BusTransaction() : operation(BusOperation::NONE), address(0), originating_core(-1), remaining_cycles(0) {}
+};
+
+
+// this si to keep track of statistics fo all cores throughout the process
+struct CoreStats {
+    uint64_t read_count = 0;
+    uint64_t write_count = 0;
+    uint64_t hit_count = 0;
+    uint64_t miss_count = 0;
+    uint64_t eviction_count = 0;
+    uint64_t writeback_count = 0;
+    uint64_t idle_cycles = 0;
+    uint64_t total_cycles = 0;
+    uint64_t invalidations = 0;
+    uint64_t data_traffic = 0;
+    // 4C breakdown of miss_count, only filled when miss classification is on
+    uint64_t compulsory_misses = 0;
+    uint64_t capacity_misses = 0;
+    uint64_t conflict_misses = 0;
+    uint64_t coherence_misses = 0;
+    // victim cache hits and the bus cycles they avoided
+    uint64_t victim_hits = 0;
+    uint64_t victim_cycles_saved = 0;
+    // blocks of a replayed hit run that were not in the cache , always 0 unless a filtered trace does not fit the run
+    uint64_t filter_violations = 0;
+    // TLB lookups and page walks , only filled when the TLBs are on
+    uint64_t tlb_l1_hits = 0;
+    uint64_t tlb_l1_misses = 0;
+    uint64_t tlb_l2_hits = 0;
+    uint64_t tlb_l2_misses = 0;
+    uint64_t walk_references = 0;
+    uint64_t walk_cycles = 0;
+    // L1 lines taken back because the inclusive L2 evicted their block
+    uint64_t back_invalidations = 0;
+    // fills of a sector whose block was already there , and the bus bytes that moving sectors instead of blocks saved
+    uint64_t sector_misses = 0;
+    uint64_t sector_bytes_saved = 0;
+    // words this core broadcast under an update protocol , the ones it took in from other cores and the hits on lines
+    // that an update had refreshed , each of which would have been a coherence miss under MESI
+    uint64_t update_broadcasts = 0;
+    uint64_t updates_received = 0;
+    uint64_t update_hits = 0;
+    // atomic accesses , the cycles this core held a line locked for them , the cycles it waited for another core's lock
+    // and the store conditionals that lost their reservation
+    uint64_t atomic_count = 0;
+    uint64_t lr_count = 0;
+    uint64_t sc_count = 0;
+    uint64_t sc_failures = 0;
+    uint64_t lock_cycles = 0;
+    uint64_t contention_cycles = 0;
+    // with more than one socket , misses served by memory of this core's socket or of another one , fills from a cache
+    // on another socket and the copies on other sockets this core's transactions invalidated
+    uint64_t numa_local_misses = 0;
+    uint64_t numa_remote_misses = 0;
+    uint64_t remote_cache_fills = 0;
+    uint64_t cross_socket_invalidations = 0;
+    // writes posted to memory under write through or no write allocate , their bytes , the write misses merged into
+    // an entry already in the write combining buffer and the cycles the core waited for its writes on the bus
+    uint64_t memory_writes = 0;
+    uint64_t memory_write_bytes = 0;
+    uint64_t combined_writes = 0;
+    uint64_t write_stall_cycles = 0;
+};
+
+// every counter of CoreStats by name , the lockstep checker walks this list so a new counter has to be added here too
+inline const std::pair<const char*, uint64_t CoreStats::*> CORE_STAT_FIELDS[] = {
+    {"read_count", &CoreStats::read_count},
+    {"write_count", &CoreStats::write_count},
+    {"hit_count", &CoreStats::hit_count},
+    {"miss_count", &CoreStats::miss_count},
+    {"eviction_count", &CoreStats::eviction_count},
+    {"writeback_count", &CoreStats::writeback_count},
+    {"idle_cycles", &CoreStats::idle_cycles},
+    {"total_cycles", &CoreStats::total_cycles},
+    {"invalidations", &CoreStats::invalidations},
+    {"data_traffic", &CoreStats::data_traffic},
+    {"compulsory_misses", &CoreStats::compulsory_misses},
+    {"capacity_misses", &CoreStats::capacity_misses},
+    {"conflict_misses", &CoreStats::conflict_misses},
+    {"coherence_misses", &CoreStats::coherence_misses},
+    {"victim_hits", &CoreStats::victim_hits},
+    {"victim_cycles_saved", &CoreStats::victim_cycles_saved},
+    {"filter_violations", &CoreStats::filter_violations},
+    {"tlb_l1_hits", &CoreStats::tlb_l1_hits},
+    {"tlb_l1_misses", &CoreStats::tlb_l1_misses},
+    {"tlb_l2_hits", &CoreStats::tlb_l2_hits},
+    {"tlb_l2_misses", &CoreStats::tlb_l2_misses},
+    {"walk_references", &CoreStats::walk_references},
+    {"walk_cycles", &CoreStats::walk_cycles},
+    {"back_invalidations", &CoreStats::back_invalidations},
+    {"sector_misses", &CoreStats::sector_misses},
+    {"sector_bytes_saved", &CoreStats::sector_bytes_saved},
+    {"update_broadcasts", &CoreStats::update_broadcasts},
+    {"updates_received", &CoreStats::updates_received},
+    {"update_hits", &CoreStats::update_hits},
+    {"atomic_count", &CoreStats::atomic_count},
+    {"lr_count", &CoreStats::lr_count},
+    {"sc_count", &CoreStats::sc_count},
+    {"sc_failures", &CoreStats::sc_failures},
+    {"lock_cycles", &CoreStats::lock_cycles},
+    {"contention_cycles", &CoreStats::contention_cycles},
+    {"numa_local_misses", &CoreStats::numa_local_misses},
+    {"numa_remote_misses", &CoreStats::numa_remote_misses},
+    {"remote_cache_fills", &CoreStats::remote_cache_fills},
+    {"cross_socket_invalidations", &CoreStats::cross_socket_invalidations},
+    {"memory_writes", &CoreStats::memory_writes},
+    {"memory_write_bytes", &CoreStats::memory_write_bytes},
+    {"combined_writes", &CoreStats::combined_writes},
+    {"write_stall_cycles", &CoreStats::write_stall_cycles},
+};
+
+// hot path counters of one core for --profile , they are not statistics of the model so the lockstep check skips them
+struct ProfileCounters {
+    uint64_t lookups = 0;
+    uint64_t lines_scanned = 0;
+    uint64_t snoop_lookups = 0;
+    uint64_t snoop_lines_scanned = 0;
+    uint64_t stall_spins = 0;
+    uint64_t bus_wait_spins = 0;
+};
+
+// cycles taken to swap a line back from the victim cache
+const int VICTIM_HIT_CYCLES = 1;
+// cycles taken to fill the L1 from the private L2
+const int L2_HIT_CYCLES = 10;
+// cycles taken by a translation that misses the L1 TLB and hits the L2 TLB , an L1 TLB hit is free
+const int TLB_L2_HIT_CYCLES = 7;
+// one word goes over the bus per update , at the 2 cycles per word of a cache to cache transfer
+const int UPDATE_WORD_BYTES = 4;
+const int UPDATE_CYCLES = 2;
+// a store of the traces writes one word , a write to memory is posted , the bus carries its words at the same 2 cycles
+// per word and memory takes them without the 100 cycles of a read
+const int STORE_BYTES = 4;
+const int POSTED_WRITE_CYCLES_PER_WORD = 2;
+
+
+// the cores are split evenly over sockets , each with its own bus , and the sockets talk over one link
+// a transfer over the link waits for the ones before it , then takes the latency plus its bytes at the link bandwidth
+struct NumaConfig {
+    uint32_t sockets = 1;
+    uint32_t link_latency = 50;
+    uint32_t link_bytes_per_cycle = 16;
+    HomePolicy home = HomePolicy::INTERLEAVE;
+    // memory is homed in pages of 4 KB
+    uint32_t page_bits = 12;
+
+    bool enabled() const { return sockets > 1; }
+};
+
+// the bus state of a socket that is not being stepped right now
+struct SocketBus {
+    std::queue<BusTransaction> queue;
+    BusTransaction current;
+    int busy_cycles = 0;
+};
+
+
+// one memory access as pushed into the simulator through the library interface
+struct Access {
+    bool is_write;
+    uint64_t address;
+    AccessKind kind = AccessKind::PLAIN;
+};
+
+// reads the next access of a trace the way Core::load_trace queues it , addresses cut down to the physical address bits
+// lines with other operations are skipped , false at the end of the trace
+inline bool read_trace_access(std::istream& file, uint64_t addr_mask, Access& access) {
+    char op;
+    uint64_t addr;
+    while (file >> op >> std::hex >> addr) {
+        AccessKind kind = AccessKind::PLAIN;
+        if (op == 'A') kind = AccessKind::RMW;
+        else if (op == 'L') kind = AccessKind::LOAD_RESERVED;
+        else if (op == 'S') kind = AccessKind::STORE_CONDITIONAL;
+        else if (op != 'R' && op != 'W') continue;
+        access = {op == 'W' || op == 'A' || op == 'S', addr & addr_mask, kind};
+        return true;
+    }
+    return false;
+}
+
+inline uint64_t paddr_mask(uint32_t paddr_bits) { return paddr_bits >= 64 ? ~0ull : (1ull << paddr_bits) - 1; }
+
+// reads a whole trace file into memory
+inline bool read_trace_accesses(const std::string& filename, uint32_t paddr_bits, std::vector<Access>& accesses) {
+    std::ifstream file(filename);
+    if (!file) return false;
+    Access access;
+    while (read_trace_access(file, paddr_mask(paddr_bits), access)) accesses.push_back(access);
+    if (!file.eof()) std::cerr << "Warning: " << filename << " is read up to its first malformed line\n";
+    return true;
+}
+
+
+// a run of accesses that trace_filter proved to be private hits , it is replayed without going through access()
+// for every block it keeps an address in it , the position of its last access in the run and if it was written
+struct HitSegment {
+    struct Block {
+        uint64_t address;
+        uint32_t last_position;
+        bool written;
+    };
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    std::vector<Block> blocks;
+
+    uint64_t count() const { return reads + writes; }
+};
+
+
+// one entry of a core's access queue , segment is 0 for a normal access and otherwise 1 + the index of a HitSegment
+struct TraceAccess {
+    uint64_t address;
+    uint32_t segment;
+    bool is_write;
+    AccessKind kind;
+};
+
+
+// contention on one block , the cycles cores waited for another core's lock on it and the store conditionals that failed
+struct BlockContention {
+    uint64_t cycles = 0;
+    uint64_t failed_sc = 0;
+};
+
+
+// sizes of the two TLB levels of every core and the page size , the TLBs are off when l1_entries is 0
+struct TlbConfig {
+    uint32_t l1_entries = 0;
+    uint32_t l1_ways = 0;
+    uint32_t l2_entries = 0;
+    uint32_t l2_ways = 0;
+    uint32_t page_bits = 12;
+
+    bool enabled() const { return l1_entries > 0; }
+};
+
+
+// the private L2 of every core , it has the block size of the L1 and is off when set_bits is 0
+struct L2Config {
+    uint32_t set_bits = 0;
+    uint32_t ways = 0;
+    InclusionPolicy policy = InclusionPolicy::INCLUSIVE;
+
+    bool enabled() const { return set_bits > 0; }
+};
+
+
+// these are the options which are not part of the cache geometry , all of them are off by default
+struct SimOptions {
+    bool classify_misses = false;
+    uint32_t victim_entries = 0;
+    IndexMode index_mode = IndexMode::MODULO;
+    uint32_t paddr_bits = 48;
+    std::string set_heatmap_file;
+    // time series sampling , off when interval_cycles is 0 , a file ending in .bin gets binary records
+    uint64_t interval_cycles = 0;
+    std::string timeseries_file;
+    // lockstep check against the generic engine , off when 0 , otherwise the cycles between cache comparisons
+    uint64_t verify_checkpoint = 0;
+    // the cores run the .ftrace files of trace_filter , their hit runs only line up with the raw traces at the end
+    bool filtered_traces = false;
+    TlbConfig tlb;
+    // a presence filter per core that lets the bus skip snooping cores which cannot hold the block
+    bool snoop_filter = false;
+    // count set scans , snoops and spin cycles on the hot paths
+    bool profile = false;
+    L2Config l2;
+    // sectors per block , each with its own MESI state and dirty bit , 1 keeps whole blocks
+    uint32_t sectors = 1;
+    CoherenceProtocol protocol = CoherenceProtocol::MESI;
+    // cycles an atomic read modify write keeps its line locked after it got it exclusive
+    uint32_t lock_latency = 10;
+    NumaConfig numa;
+    // write through keeps every line clean and posts each write hit to memory , without write allocate a write miss
+    // is posted to memory and not brought in , and with combining_entries those posts are merged per block first
+    bool write_through = false;
+    bool write_allocate = true;
+    uint32_t combining_entries = 0;
+};
+
+// the write policy as print_stats shows it , separator goes between its parts
+inline std::string write_policy_name(const SimOptions& options, const std::string& separator) {
+    std::string name = options.write_through ? "Write-through" : "Write-back";
+    name += separator + (options.write_allocate ? "Write-allocate" : "No-write-allocate");
+    if (options.combining_entries > 0) name += separator + std::to_string(options.combining_entries) + " entry write combining";
+    return name;
+}
+
+
+// this classifies every miss as compulsory, capacity, conflict or coherence
+// it keeps the blocks seen so far, the blocks that were invalidated by other cores and a fully associative
+// LRU cache with the same number of lines as the real one , a miss that would hit there is a conflict miss
+class MissClassifier {
+public:
+    size_t capacity = 0;
+    std::unordered_set<uint64_t> seen_blocks;
+    std::unordered_set<uint64_t> invalidated_blocks;
+    std::list<uint64_t> lru_order;
+    std::unordered_map<uint64_t, std::list<uint64_t>::iterator> shadow_lines;
+
+public:
+    // moves the block to the front of the shadow cache and returns if it was already there
+    bool touch(uint64_t block) {
+        auto it = shadow_lines.find(block);
+        if (it != shadow_lines.end()) {
+            lru_order.splice(lru_order.begin(), lru_order, it->second);
+            return true;
+        }
+        lru_order.push_front(block);
+        shadow_lines[block] = lru_order.begin();
+        if (lru_order.size() > capacity) {
+            shadow_lines.erase(lru_order.back());
+            lru_order.pop_back();
+        }
+        return false;
+    }
+
+    // called from the snooping side when another core takes this block away
+    void record_invalidation(uint64_t block) { invalidated_blocks.insert(block); }
+
+    // called once per miss that goes on the bus , the order of the checks decides the class
+    void classify(uint64_t block, CoreStats& stats) {
+        bool shadow_hit = touch(block);
+        if (seen_blocks.insert(block).second) {
+            stats.compulsory_misses++;
+        } else if (invalidated_blocks.erase(block)) {
+            stats.coherence_misses++;
+        } else if (shadow_hit) {
+            stats.conflict_misses++;
+        } else {
+            stats.capacity_misses++;
+        }
+    }
+};
+
+
+// where a block goes in the cache , for the skewed mode index is the set of way 0 (way_index(loc, 0))
+// tag is the full tag , a line matches if its tag is tag_low and its tag_region is region
+struct BlockLocation {
+    uint64_t block = 0;
+    uint64_t tag = 0;
+    uint32_t index = 0;
+    uint32_t tag_low = 0;
+    uint16_t region = 0;
+};
+
+
+// the tag bits above the low 32 , shared by all the lines of a cache
+// a real address space only uses a few distinct values up there (heap, stack, mappings) so they are stored once
+// with a reference count and lines keep a 16 bit id , id 0 always stands for 0 so 32 bit traces never touch the map
+class TagRegionTable {
+public:
+    static const uint16_t NO_REGION = 0xFFFF;
+    std::vector<uint64_t> high_bits{0};
+    std::vector<uint32_t> refs{0};
+    std::unordered_map<uint64_t, uint16_t> ids;
+    std::vector<uint16_t> free_ids;
+
+public:
+    // the id of the upper bits if any line uses them , NO_REGION otherwise
+    uint16_t find(uint64_t high) const {
+        if (high == 0) return 0;
+        auto it = ids.find(high);
+        return it == ids.end() ? NO_REGION : it->second;
+    }
+
+    // takes a reference for a line being filled , new is set when an id had to be handed out
+    uint16_t acquire(uint64_t high, bool& added) {
+        added = false;
+        if (high == 0) return 0;
+        auto it = ids.find(high);
+        if (it != ids.end()) {
+            refs[it->second]++;
+            return it->second;
+        }
+        uint16_t id;
+        if (!free_ids.empty()) {
+            id = free_ids.back();
+            free_ids.pop_back();
+        } else {
+            // a wrapped id would make two different tags look the same , the callers size caches so this never happens
+            if (high_bits.size() >= NO_REGION) {
+                std::cerr << "Error: more than " << NO_REGION - 1 << " distinct upper tag bits in one cache\n";
+                std::abort();
+            }
+            id = high_bits.size();
+            high_bits.push_back(0);
+            refs.push_back(0);
+        }
+        high_bits[id] = high;
+        refs[id] = 1;
+        ids[high] = id;
+        added = true;
+        return id;
+    }
+
+    // drops the reference of a line that is evicted or invalidated , returns true when the id was freed
+    bool release(uint16_t id) {
+        if (id == 0 || --refs[id] > 0) return false;
+        ids.erase(high_bits[id]);
+        free_ids.push_back(id);
+        return true;
+    }
+};
+
+
+// counters of one set for the set heatmap , in skewed mode all the counters of an access go to the set of way 0
+// whichever way it hit in or evicted from , so an access is only ever counted in one row
+struct SetStats {
+    uint64_t accesses = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+};
+
+
+// a set associative TLB with LRU replacement , pages are mapped one to one so an entry only needs its page number
+class Tlb {
+public:
+    struct Entry {
+        uint64_t page = 0;
+        uint64_t lru_counter = 0;
+        bool valid = false;
+    };
+    uint32_t sets = 0;
+    uint32_t ways = 0;
+    std::vector<Entry> entries;
+    uint64_t current_lru_counter = 0;
+
+    void configure(uint32_t entry_count, uint32_t way_count) {
+        ways = way_count;
+        sets = entry_count / way_count;
+        entries.assign(sets * ways, Entry());
+    }
+
+    bool lookup(uint64_t page) {
+        Entry* set = &entries[(page % sets) * ways];
+        for (uint32_t w = 0; w < ways; w++) {
+            if (set[w].valid && set[w].page == page) {
+                set[w].lru_counter = ++current_lru_counter;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void insert(uint64_t page) {
+        Entry* set = &entries[(page % sets) * ways];
+        Entry* target = &set[0];
+        for (uint32_t w = 0; w < ways && target->valid; w++) {
+            if (!set[w].valid || set[w].lru_counter < target->lru_counter) target = &set[w];
+        }
+        target->page = page;
+        target->valid = true;
+        target->lru_counter = ++current_lru_counter;
+    }
+};
+
+
+// a counting Bloom filter of the blocks a core holds in its sets and its victim cache , every block sets two counters
+// may_contain never says no for a block that is there , so a snoop it rules out would not have found anything
+class PresenceFilter {
+public:
+    std::vector<uint16_t> counters;
+    uint64_t mask = 0;
+
+    // four counters per line keeps false positives to a few percent with two hashes
+    void configure(size_t lines) {
+        size_t size = 64;
+        while (size < 4 * lines) size <<= 1;
+        counters.assign(size, 0);
+        mask = size - 1;
+    }
+
+    bool enabled() const { return !counters.empty(); }
+
+    void add(uint64_t block) {
+        if (!enabled()) return;
+        counters[first_slot(block)]++;
+        counters[second_slot(block)]++;
+    }
+
+    void remove(uint64_t block) {
+        if (!enabled()) return;
+        counters[first_slot(block)]--;
+        counters[second_slot(block)]--;
+    }
+
+    bool may_contain(uint64_t block) const {
+        return counters[first_slot(block)] != 0 && counters[second_slot(block)] != 0;
+    }
+
+private:
+    static uint64_t hash(uint64_t block) { return block * 0x9E3779B97F4A7C15ull; }
+    size_t first_slot(uint64_t block) const { return (hash(block) >> 20) & mask; }
+    size_t second_slot(uint64_t block) const { return (hash(block) >> 42) & mask; }
+};
+
+
+// a line that left a cache which has a level below it , the core decides where it goes
+struct EvictedLine {
+    bool valid = false;
+    uint64_t block = 0;
+    MESIState state = MESIState::INVALID;
+    bool dirty = false;
+};
+
+
+// the coherence state of one sector of a sectored line
+struct SectorState {
+    MESIState state = MESIState::INVALID;
+    bool dirty = false;
+};
+
+
+// the victim cache is small so its lines just keep the whole block address next to them
+struct VictimLine {
+    uint64_t block = 0;
+    CacheLine line;
+};
+
+// one entry of a write combining buffer , the block and a mask of the words written to it so far
+struct CombiningEntry {
+    uint64_t block;
+    uint64_t words;
+};
+
+
+// this is my cache class , it includes all the parametrs along with the functions i need to access the cache and update it
+// and also to handle the bus transactions
+// S_BITS, WAYS and B_BITS fix the geometry at compile time so the shifts are constants and the set scans have a known
+// trip count , Cache<> (all zero) is the generic one which takes the geometry from the constructor
+template <uint32_t S_BITS = 0, uint32_t WAYS = 0, uint32_t B_BITS = 0>
+class Cache {
+public:
+    int core_id;
+    uint32_t sets;
+    uint32_t associativity;
+    uint32_t block_size;
+    uint32_t index_bits;
+    uint32_t block_offset_bits;
+    // all the lines in one array , set i is cache_lines[i*E .. i*E+E-1]
+    std::vector<CacheLine> cache_lines;
+    CoreStats stats;
+    uint32_t current_lru_counter;
+    // the miss classifier , null when classification is off so an unclassified run only tests the pointer
+    std::unique_ptr<MissClassifier> classifier;
+    // fully associative victim cache , empty when it is switched off
+    std::vector<VictimLine> victim_lines;
+    TagRegionTable tag_regions;
+    // per set counters for the heatmap , empty unless it was asked for
+    std::vector<SetStats> set_stats;
+    // the blocks this cache holds , only kept up to date when the snoop filter is on
+    PresenceFilter presence;
+    bool profiling = false;
+    ProfileCounters profile;
+    // with a private L2 below , an evicted line is left in spilled for the core instead of being written back here
+    bool spill_evictions = false;
+    EvictedLine spilled;
+    // a sectored cache keeps the tag per line and the state per sector , sector_states has sector_count per line
+    // and is empty with whole blocks , sector_data is what a snooped sector answers with
+    uint32_t sector_count = 1;
+    uint32_t sector_size = 0;
+    std::vector<SectorState> sector_states;
+    std::vector<uint8_t> sector_data;
+    // under an update protocol one mark per line says an update from another core refreshed it since its last hit
+    CoherenceProtocol protocol = CoherenceProtocol::MESI;
+    std::vector<uint8_t> update_marks;
+    // the block of the last load reserved , a write of it by another core ends the reservation
+    bool reservation = false;
+    uint64_t reserved_block = 0;
+    // contention per block , only filled in when the traces have atomic accesses
+    std::unordered_map<uint64_t, BlockContention> contention;
+    // the write policy , write back and write allocate unless the options say otherwise
+    bool write_through = false;
+    bool write_allocate = true;
+    IndexMode index_mode = IndexMode::MODULO;
+    uint32_t prime_sets;
+    BlockLocation last_location;
+    bool last_location_valid = false;
+
+public:
+// this defines by cache basic structure with tis assosciativity adn block slze adn no. of blocks
+    static constexpr bool fixed_geometry = S_BITS != 0 && WAYS != 0 && B_BITS != 0;
+
+    Cache(int id, uint32_t s, uint32_t E, uint32_t b) 
+        : core_id(id), sets(1 << s), associativity(E), block_size(1 << b),
+          index_bits(s), block_offset_bits(b), current_lru_counter(0), prime_sets(largest_prime_upto(1 << s)) {
+        if (fixed_geometry && (s != S_BITS || E != WAYS || b != B_BITS)) {
+            std::cerr << "Core " << id << ": cache geometry does not match its specialization\n";
+        }
+        cache_lines.resize(sets * associativity);
+        for (auto& line : cache_lines) {
+            line.valid = false;
+            line.dirty = false;
+            line.state = MESIState::INVALID;
+            line.lru_counter = 0;
+            line.data.resize(block_size);
+        }
+    }
+
+    // the geometry as used on the hot paths , these fold to constants in a specialized cache
+    uint32_t set_bits() const {
+        if constexpr (fixed_geometry) return S_BITS;
+        else return index_bits;
+    }
+
+    uint32_t ways() const {
+        if constexpr (fixed_geometry) return WAYS;
+        else return associativity;
+    }
+
+    uint32_t offset_bits() const {
+        if constexpr (fixed_geometry) return B_BITS;
+        else return block_offset_bits;
+    }
+
+    CacheLine& line_at(uint32_t index, uint32_t way) { return cache_lines[index * ways() + way]; }
+
+    static uint32_t largest_prime_upto(uint32_t n) {
+        for (uint32_t p = n; p > 2; p--) {
+            bool prime = true;
+            for (uint32_t d = 2; d * d <= p; d++) {
+                if (p % d == 0) {
+                    prime = false;
+                    break;
+                }
+            }
+            if (prime) return p;
+        }
+        return 2;
+    }
+
+    void enable_sectors(uint32_t count) {
+        sector_count = count;
+        sector_size = block_size / count;
+        sector_states.assign(cache_lines.size() * count, SectorState());
+        sector_data.assign(sector_size, 0);
+    }
+
+    SectorState& sector_at(const CacheLine& line, uint64_t address) {
+        uint32_t sector = static_cast<uint32_t>((address & (block_size - 1)) / sector_size);
+        return sector_states[(&line - cache_lines.data()) * sector_count + sector];
+    }
+
+    void enable_update_protocol(CoherenceProtocol p) {
+        protocol = p;
+        update_marks.assign(cache_lines.size(), 0);
+    }
+
+    void clear_update_mark(const CacheLine& line) {
+        if (!update_marks.empty()) update_marks[&line - cache_lines.data()] = 0;
+    }
+
+    // the writer's copy once its write has been on the bus , shared is the shared line of the broadcast and
+    // broadcast says if the word went out at all , a Firefly broadcast also wrote memory so the copy stays clean
+    void settle_write(uint64_t address, bool shared, bool broadcast) {
+        CacheLine* line = find_line(locate(address));
+        if (!line) return;
+        if (shared) {
+            line->state = MESIState::SHARED;
+            line->dirty = protocol == CoherenceProtocol::DRAGON;
+        } else if (broadcast && protocol == CoherenceProtocol::FIREFLY) {
+            line->state = MESIState::EXCLUSIVE;
+            line->dirty = false;
+        } else {
+            line->state = MESIState::MODIFIED;
+            line->dirty = true;
+        }
+    }
+
+    // a store conditional only goes ahead if the reservation is still on its block and the line is still here
+    bool reserved(uint64_t address) {
+        const BlockLocation& loc = locate(address);
+        return reservation && reserved_block == loc.block && find_line(loc) != nullptr;
+    }
+
+    void enable_miss_classifier() {
+        classifier = std::make_unique<MissClassifier>();
+        classifier->capacity = sets * associativity;
+    }
+
+    void enable_victim_cache(uint32_t entries) {
+        victim_lines.resize(entries);
+        for (auto& entry : victim_lines) {
+            entry.line.valid = false;
+            entry.line.dirty = false;
+            entry.line.state = MESIState::INVALID;
+            entry.line.lru_counter = 0;
+        }
+    }
+
+    // these keep the shadow cache of the classifier in step with the real accesses
+    // they also feed the per set counters when those are on
+    void record_hit(uint64_t address) {
+        if (classifier) classifier->touch(address >> offset_bits());
+        if (!set_stats.empty()) set_stats[locate(address).index].accesses++;
+    }
+
+    void record_miss(uint64_t address) {
+        if (classifier) classifier->classify(address >> offset_bits(), stats);
+        if (!set_stats.empty()) {
+            SetStats& set = set_stats[locate(address).index];
+            set.accesses++;
+            set.misses++;
+        }
+    }
+
+    void record_eviction(uint32_t index) {
+        stats.eviction_count++;
+        if (!set_stats.empty()) set_stats[index].evictions++;
+    }
+
+
+// this function is used for hits adn misses in my caches and return that if i need to access the bus or not , it getes retured value to function cycle
+
+    std::pair<bool,int> access(uint64_t address, bool is_write, BusTransaction& bus_trans,bool bus_empty) {
+        const BlockLocation& loc = locate(address);
+
+        bus_trans.operation = BusOperation::NONE;
+        bus_trans.write_miss = false;
+
+        CacheLine* found = find_line(loc);
+        if (profiling) {
+            profile.lookups++;
+            profile.lines_scanned += scan_length(loc, found);
+        }
+        // in a sectored cache the block has to be there and so does the sector , whose state then decides
+        if (found && sector_count > 1 && sector_at(*found, address).state == MESIState::INVALID) found = nullptr;
+        if (found) {
+            CacheLine& line = *found;
+            MESIState& state = sector_count > 1 ? sector_at(line, address).state : line.state;
+            bool& dirty = sector_count > 1 ? sector_at(line, address).dirty : line.dirty;
+            line.lru_counter = ++current_lru_counter;
+            if (is_write) {
+                if (write_through) {
+                    // the word is posted to memory , which takes the other copies and leaves this one clean and
+                    // exclusive , so a write through cache never holds a modified line
+                    if (!bus_empty) {
+                        line.lru_counter = --current_lru_counter;
+                        bus_trans.address = address;
+                        return {false, 1};
+                    }
+                    bus_trans.operation = BusOperation::BUS_WRITE;
+                    bus_trans.address = address;
+                    bus_trans.bytes = STORE_BYTES;
+                    state = MESIState::EXCLUSIVE;
+                    dirty = false;
+                }
+                else if (state == MESIState::SHARED && protocol != CoherenceProtocol::MESI) {
+                    // the copies are updated instead of invalidated , the simulator settles this line once it knows
+                    // if any of them are left
+                    if (!bus_empty) {
+                        line.lru_counter = --current_lru_counter;
+                        bus_trans.address = address;
+                        return {false, 1};
+                    }
+                    bus_trans.operation = BusOperation::BUS_UPDATE;
+                    bus_trans.address = address;
+                }
+                else if (state == MESIState::SHARED) {
+                    if(bus_empty){
+                    bus_trans.operation = BusOperation::INVALIDATE;
+                    bus_trans.address = address;
+                    state = MESIState::MODIFIED;
+                    dirty = true;
+                    return {true, 1};
+                }
+                else {
+                    line.lru_counter = --current_lru_counter;
+                    bus_trans.address = address;
+                    return {false, 1};
+                }
+                }
+                else {
+                    state = MESIState::MODIFIED;
+                    dirty = true;
+                }
+            }
+            if (!update_marks.empty() && update_marks[&line - cache_lines.data()]) {
+                update_marks[&line - cache_lines.data()] = 0;
+                stats.update_hits++;
+            }
+            return {true, 1};
+        }
+
+        // stats.miss_count++;
+        if (is_write && !write_allocate) {
+            // the word goes to memory and the block is not brought in
+            bus_trans.operation = BusOperation::BUS_WRITE;
+            bus_trans.bytes = STORE_BYTES;
+        } else if (protocol != CoherenceProtocol::MESI) {
+            bus_trans.operation = BusOperation::BUS_READ;
+            bus_trans.write_miss = is_write;
+        } else {
+            bus_trans.operation = is_write ? BusOperation::BUS_READX : BusOperation::BUS_READ;
+        }
+        bus_trans.address = address;
+        return {false, 1};
+    }
+
+
+    // this function is called by handle_nus_read and in this i am updating the snooping operation , i.e checking for each core it is called 
+    // it returns what became of this cache's copy , so the caller does not have to look the block up again
+    SnoopResult handle_bus_transaction(BusTransaction& trans, BusTransaction& response) {
+        const BlockLocation& loc = locate(trans.address);
+        if (reservation && loc.block == reserved_block && trans.operation != BusOperation::BUS_READ) reservation = false;
+
+        CacheLine* line = find_line(loc);
+        if (profiling) {
+            profile.snoop_lookups++;
+            profile.snoop_lines_scanned += scan_length(loc, line);
+        }
+        if (line && sector_count > 1) {
+            return snoop_sector(*line, loc, trans, response) ? SnoopResult::INVALIDATED : SnoopResult::KEPT;
+        }
+        if (line) {
+            if (snoop_line(*line, trans, response)) {
+                release_tag(*line);
+                presence.remove(loc.block);
+                return SnoopResult::INVALIDATED;
+            }
+            if (trans.operation == BusOperation::BUS_UPDATE && !update_marks.empty()) {
+                update_marks[line - cache_lines.data()] = 1;
+            }
+            return SnoopResult::KEPT;
+        }
+
+        // a block can only be in one of the two places , so the victim cache is checked only if the set missed
+        for (auto& entry : victim_lines) {
+            if (entry.line.valid && entry.block == loc.block) {
+                if (!snoop_line(entry.line, trans, response)) return SnoopResult::KEPT;
+                presence.remove(loc.block);
+                return SnoopResult::INVALIDATED;
+            }
+        }
+        return SnoopResult::MISSED;
+    }
+
+    // this is the MESI reaction of one line to a snooped transaction , same for a line in a set or in the victim cache
+    // it returns true if the line was invalidated
+    bool snoop_line(CacheLine& line, BusTransaction& trans, BusTransaction& response) {
+        if (!snoop_state(line.state, line.dirty, line.data, trans, response)) return false;
+        line.valid = false;
+        return true;
+    }
+
+    // only the snooped sector reacts , the line is given up once none of its sectors is valid any more
+    // it returns true if the line was given up
+    bool snoop_sector(CacheLine& line, const BlockLocation& loc, BusTransaction& trans, BusTransaction& response) {
+        SectorState& sector = sector_at(line, trans.address);
+        if (sector.state == MESIState::INVALID) return false;
+        bool invalidated = snoop_state(sector.state, sector.dirty, sector_data, trans, response);
+        if (response.operation == BusOperation::FLUSH) stats.sector_bytes_saved += block_size - sector_size;
+        if (!invalidated) return false;
+        sector.dirty = false;
+        SectorState* sectors = &sector_states[(&line - cache_lines.data()) * sector_count];
+        for (uint32_t i = 0; i < sector_count; i++) {
+            if (sectors[i].state != MESIState::INVALID) return false;
+        }
+        line.valid = false;
+        line.state = MESIState::INVALID;
+        release_tag(line);
+        presence.remove(loc.block);
+        return true;
+    }
+
+    // the MESI reaction itself , for a whole line or for one sector of a sectored line
+    bool snoop_state(MESIState& state, bool& dirty, const std::vector<uint8_t>& data, BusTransaction& trans, BusTransaction& response) {
+        switch (trans.operation) {
+            case BusOperation::BUS_READ:
+                if (state == MESIState::MODIFIED && protocol == CoherenceProtocol::DRAGON) {
+                    // the Dragon owner hands the block over cache to cache and keeps it dirty as the shared owner
+                    response.data = data;
+                    state = MESIState::SHARED;
+                } else if (state == MESIState::MODIFIED) {
+                    stats.writeback_count++;
+                    response.operation = BusOperation::FLUSH;
+                    response.data = data;
+                    state = MESIState::SHARED;
+                    if (protocol == CoherenceProtocol::FIREFLY) dirty = false;
+                    // stats.data_traffic += block_size;
+                } else if (state == MESIState::EXCLUSIVE || state == MESIState::SHARED) {
+                    response.data = data;
+                    state = MESIState::SHARED;
+                    // stats.data_traffic += block_size;
+                }
+                return false;
+            case BusOperation::BUS_READX:
+            case BusOperation::BUS_WRITE:
+                state = MESIState::INVALID;
+                if (classifier) classifier->record_invalidation(trans.address >> offset_bits());
+                if (dirty) {
+                    stats.writeback_count++;
+                    response.operation = BusOperation::FLUSH;
+                    response.data = data;
+                    // stats.data_traffic += block_size;
+                }
+                return true;
+            case BusOperation::INVALIDATE:
+                state = MESIState::INVALID;
+                stats.invalidations++;
+                if (classifier) classifier->record_invalidation(trans.address >> offset_bits());
+                // stats.invalidations++;
+                return true;
+            case BusOperation::BUS_UPDATE:
+                // the word is written into this copy , under Dragon the writer becomes the owner
+                state = MESIState::SHARED;
+                if (protocol == CoherenceProtocol::DRAGON) dirty = false;
+                response.shared = true;
+                stats.updates_received++;
+                return false;
+            default:
+                return false;
+        }
+    }
+
+
+    // it is used to install the block in the cache and update the stats accordingly and also checks for cache evictions if needed 
+    int install_block(uint64_t address, const std::vector<uint8_t>& data, MESIState state,  uint64_t* total_bus_traffic) {
+        if (sector_count > 1) return install_sector(address, state);
+        const BlockLocation& loc = locate(address);
+        uint64_t tag = loc.tag;
+        uint32_t way = 0;
+        CacheLine* target = replacement_line(loc, way);
+
+        int eviction_cycles = 0;
+        if (target->valid) {
+            record_eviction(loc.index);
+            if (!victim_lines.empty()) {
+                // the victim is kept , only the line pushed out of the victim cache has to be written back
+                eviction_cycles += insert_victim(*target, block_of(full_tag(*target), way_index(loc, way), way));
+            } else {
+                uint64_t victim_block = block_of(full_tag(*target), way_index(loc, way), way);
+                presence.remove(victim_block);
+                if (spill_evictions) {
+                    spilled = {true, victim_block, target->state, target->dirty};
+                } else if (target->dirty) {
+                    stats.writeback_count++;
+                    eviction_cycles += 100;
+                }
+            }
+            release_tag(*target);
+        }
+        presence.add(loc.block);
+
+        target->valid = true;
+        set_tag(*target, tag);
+        target->dirty = false;
+        target->state = state;
+        target->lru_counter = ++current_lru_counter;
+        target->data = data;
+        clear_update_mark(*target);
+        stats.data_traffic += block_size*8;
+        total_bus_traffic += block_size*8;
+
+        return eviction_cycles;
+    }
+
+    // applies a run of private hits at once , every block gets the LRU counter of its last access and written blocks
+    // become modified , exactly as if the accesses had gone through access() one by one
+    void replay_hits(const HitSegment& segment) {
+        uint32_t base = current_lru_counter;
+        for (const auto& block : segment.blocks) {
+            CacheLine* line = find_line(locate(block.address));
+            if (!line) {
+                stats.filter_violations++;
+                continue;
+            }
+            line->lru_counter = base + block.last_position + 1;
+            if (block.written) {
+                line->state = MESIState::MODIFIED;
+                line->dirty = true;
+            }
+        }
+        current_lru_counter = base + segment.count();
+    }
+
+    // a sectored fill only brings the missing sector , the line is only replaced if the block is not there at all
+    // and then only its dirty sectors are written back
+    int install_sector(uint64_t address, MESIState state) {
+        const BlockLocation& loc = locate(address);
+        CacheLine* target = find_line(loc);
+        int eviction_cycles = 0;
+        if (target) {
+            stats.sector_misses++;
+        } else {
+            uint32_t way = 0;
+            target = replacement_line(loc, way);
+            SectorState* sectors = &sector_states[(target - cache_lines.data()) * sector_count];
+            if (target->valid) {
+                record_eviction(loc.index);
+                presence.remove(block_of(full_tag(*target), way_index(loc, way), way));
+                uint32_t dirty_sectors = 0;
+                for (uint32_t i = 0; i < sector_count; i++) {
+                    if (sectors[i].state != MESIState::INVALID && sectors[i].dirty) dirty_sectors++;
+                }
+                if (dirty_sectors > 0) {
+                    stats.writeback_count++;
+                    stats.sector_bytes_saved += block_size - dirty_sectors * sector_size;
+                    eviction_cycles += 100;
+                }
+                release_tag(*target);
+            }
+            presence.add(loc.block);
+            target->valid = true;
+            set_tag(*target, loc.tag);
+            target->dirty = false;
+            for (uint32_t i = 0; i < sector_count; i++) sectors[i] = SectorState();
+        }
+        target->state = state;
+        target->lru_counter = ++current_lru_counter;
+        sector_at(*target, address) = {state, false};
+        stats.data_traffic += sector_size*8;
+        stats.sector_bytes_saved += block_size - sector_size;
+        return eviction_cycles;
+    }
+
+    // takes a block out of the sets without a bus transaction , for the back invalidation of an inclusive L2
+    // it returns true if the line was there and dirty , the caller writes it back
+    bool drop_block(uint64_t address, bool& found) {
+        const BlockLocation& loc = locate(address);
+        CacheLine* line = find_line(loc);
+        found = line != nullptr;
+        if (!line) return false;
+        bool dirty = line->dirty;
+        line->valid = false;
+        line->dirty = false;
+        line->state = MESIState::INVALID;
+        release_tag(*line);
+        presence.remove(loc.block);
+        return dirty;
+    }
+
+    // puts a line evicted from a set into the victim cache, the LRU victim entry is dropped and written back if dirty
+    int insert_victim(CacheLine& line, uint64_t block) {
+        VictimLine* slot = nullptr;
+        for (auto& entry : victim_lines) {
+            if (!entry.line.valid) {
+                slot = &entry;
+                break;
+            }
+            if (!slot || entry.line.lru_counter < slot->line.lru_counter) {
+                slot = &entry;
+            }
+        }
+
+        int writeback_cycles = 0;
+        if (slot->line.valid) presence.remove(slot->block);
+        if (slot->line.valid && slot->line.dirty) {
+            stats.writeback_count++;
+            writeback_cycles += 100;
+        }
+        std::swap(slot->line.data, line.data);
+        slot->block = block;
+        slot->line.valid = true;
+        slot->line.dirty = line.dirty;
+        slot->line.state = line.state;
+        slot->line.lru_counter = line.lru_counter;
+        return writeback_cycles;
+    }
+
+    // this is probed when the set misses and before the bus is asked , on a hit the line is swapped back into its set
+    // with the line it replaces going to the victim cache , it returns false if the block is not there
+    bool swap_from_victim(uint64_t address) {
+        const BlockLocation& loc = locate(address);
+        uint64_t tag = loc.tag;
+        VictimLine* entry = nullptr;
+        for (auto& victim : victim_lines) {
+            if (victim.line.valid && victim.block == loc.block) {
+                entry = &victim;
+                break;
+            }
+        }
+        if (!entry) return false;
+
+        uint32_t way = 0;
+        CacheLine* target = replacement_line(loc, way);
+
+        // a memory fetch is needed unless another core could have supplied the block
+        stats.victim_hits++;
+        stats.victim_cycles_saved += (entry->line.state == MESIState::SHARED ? 2 * (block_size / 4) : 100) - VICTIM_HIT_CYCLES;
+
+        CacheLine restored = std::move(entry->line);
+        entry->line.valid = false;
+        if (target->valid) {
+            record_eviction(loc.index);
+            entry->block = block_of(full_tag(*target), way_index(loc, way), way);
+            std::swap(entry->line.data, target->data);
+            entry->line.valid = true;
+            entry->line.dirty = target->dirty;
+            entry->line.state = target->state;
+            entry->line.lru_counter = target->lru_counter;
+            release_tag(*target);
+        }
+        *target = std::move(restored);
+        set_tag(*target, tag);
+        target->lru_counter = ++current_lru_counter;
+        clear_update_mark(*target);
+        return true;
+    }
+
+
+    // all of the set index functions live here , everything else goes through locate , find_line and replacement_line
+    // the last address is remembered so an access that keeps retrying while the bus is busy and then installs its
+    // block only works out its set once
+    const BlockLocation& locate(uint64_t address) {
+        uint64_t block = address >> offset_bits();
+        if (block == last_location.block && last_location_valid) return last_location;
+
+        uint64_t mask = (1u << set_bits()) - 1;
+        last_location.block = block;
+        switch (index_mode) {
+            case IndexMode::PRIME_MODULO:
+                last_location.tag = block / prime_sets;
+                last_location.index = block % prime_sets;
+                break;
+            case IndexMode::XOR_FOLD:
+                last_location.tag = block >> set_bits();
+                last_location.index = (block ^ fold_tag(last_location.tag)) & mask;
+                break;
+            case IndexMode::SKEWED:
+                // the set of way 0 , way_index gives the others
+                last_location.tag = block >> set_bits();
+                last_location.index = (block ^ skew_hash(last_location.tag, 0)) & mask;
+                break;
+            default:
+                last_location.tag = block >> set_bits();
+                last_location.index = block & mask;
+                break;
+        }
+        last_location.tag_low = static_cast<uint32_t>(last_location.tag);
+        last_location.region = tag_regions.find(last_location.tag >> 32);
+        last_location_valid = true;
+        return last_location;
+    }
+
+    // the set a block maps to in a given way , only the skewed mode gives every way its own hash
+    uint32_t way_index(const BlockLocation& loc, uint32_t way) const {
+        if (index_mode != IndexMode::SKEWED) return loc.index;
+        return (loc.block ^ skew_hash(loc.tag, way)) & ((1u << set_bits()) - 1);
+    }
+
+    // inverse of locate , it gives back the block address of a line from its tag and where it sits
+    uint64_t block_of(uint64_t tag, uint32_t index, uint32_t way) const {
+        uint64_t mask = (1u << set_bits()) - 1;
+        switch (index_mode) {
+            case IndexMode::PRIME_MODULO:
+                return tag * prime_sets + index;
+            case IndexMode::XOR_FOLD:
+                return (tag << set_bits()) | ((index ^ fold_tag(tag)) & mask);
+            case IndexMode::SKEWED:
+                return (tag << set_bits()) | ((index ^ skew_hash(tag, way)) & mask);
+            default:
+                return (tag << set_bits()) | index;
+        }
+    }
+
+    CacheLine* find_line(const BlockLocation& loc) {
+        if (index_mode != IndexMode::SKEWED) {
+            CacheLine* set = &cache_lines[loc.index * ways()];
+            for (uint32_t way = 0; way < ways(); way++) {
+                if (set[way].valid && set[way].tag == loc.tag_low && set[way].tag_region == loc.region) return &set[way];
+            }
+            return nullptr;
+        }
+        for (uint32_t way = 0; way < ways(); way++) {
+            CacheLine& line = line_at(way_index(loc, way), way);
+            if (line.valid && line.tag == loc.tag_low && line.tag_region == loc.region) return &line;
+        }
+        return nullptr;
+    }
+
+    // how many lines find_line compared before it returned found , all of them when it missed
+    uint32_t scan_length(const BlockLocation& loc, const CacheLine* found) {
+        if (!found) return ways();
+        for (uint32_t way = 0; way < ways(); way++) {
+            if (&line_at(way_index(loc, way), way) == found) return way + 1;
+        }
+        return ways();
+    }
+
+    // an invalid line if there is one , otherwise the LRU one among the places the block can go
+    CacheLine* replacement_line(const BlockLocation& loc, uint32_t& way) {
+        CacheLine* target = nullptr;
+        for (uint32_t w = 0; w < ways(); w++) {
+            CacheLine& line = line_at(way_index(loc, w), w);
+            if (!line.valid) {
+                way = w;
+                return &line;
+            }
+            if (!target || line.lru_counter < target->lru_counter) {
+                target = &line;
+                way = w;
+            }
+        }
+        return target;
+    }
+
+    // the compact tag of a line , taking or dropping a reference on the upper bits
+    // a new or freed region changes what locate would find so the remembered location is dropped then
+    uint64_t full_tag(const CacheLine& line) const {
+        return (tag_regions.high_bits[line.tag_region] << 32) | line.tag;
+    }
+
+    void set_tag(CacheLine& line, uint64_t tag) {
+        bool added = false;
+        line.tag = static_cast<uint32_t>(tag);
+        line.tag_region = tag_regions.acquire(tag >> 32, added);
+        if (added) last_location_valid = false;
+    }
+
+    void release_tag(CacheLine& line) {
+        if (tag_regions.release(line.tag_region)) last_location_valid = false;
+    }
+
+    // xor of all the index sized chunks of the tag
+    uint64_t fold_tag(uint64_t tag) const {
+        uint64_t folded = 0;
+        for (; tag != 0; tag >>= set_bits()) folded ^= tag;
+        return folded;
+    }
+
+    // a different multiplicative hash of the tag for every way
+    uint64_t skew_hash(uint64_t tag, uint32_t way) const {
+        uint64_t h = tag * (0x9E3779B97F4A7C15ull + 2 * way);
+        return h ^ (h >> 29);
+    }
+};
+
+
+// this is the core class which includes the cache and the instructions queue and also the stall cycles and bus transactions
+// this is the main class which is used to load the traces and run the cycles
+template <class CacheT>
+class Core {
+public:
+    int id;
+    CacheT cache;
+    std::queue<TraceAccess> instructions;
+    // hit runs of a filtered trace and how many cycles of the one being replayed are still to go
+    std::vector<HitSegment> hit_segments;
+    uint64_t segment_cycles_left = 0;
+    // the TLBs and the page walk in progress , the walk reads go before the access at the front of the queue
+    bool tlb_enabled = false;
+    Tlb l1_tlb;
+    Tlb l2_tlb;
+    uint32_t page_bits = 12;
+    uint32_t walk_levels = 0;
+    uint64_t page_table_base = 0;
+    uint64_t page_table_level_span = 0;
+    uint64_t walk_addresses[8];
+    uint32_t walk_next = 0;
+    uint32_t walk_count = 0;
+    bool front_translated = false;
+    // the private L2 , null when there is none , it always runs on the generic cache
+    std::unique_ptr<Cache<>> l2;
+    InclusionPolicy inclusion = InclusionPolicy::INCLUSIVE;
+    int stall_cycles = 0;
+    bool waiting_for_bus = false;
+    // the last try of the access at the front found the bus taken , unlike waiting_for_bus this is cleared as soon
+    // as the core tries again
+    bool bus_blocked = false;
+    BusTransaction pending_bus_trans;
+    // the line an atomic read modify write holds and for how many more cycles , and a store conditional that failed
+    // and goes back to its load reserved before it is tried again
+    uint32_t lock_latency = 10;
+    uint64_t locked_block = 0;
+    uint32_t lock_cycles_left = 0;
+    bool reserving = false;
+    bool has_atomics = false;
+    // the write misses that were not allocated wait here , merged per block , until the buffer is full or a read of
+    // their block needs memory up to date , off when combining_entries is 0
+    uint32_t combining_entries = 0;
+    std::deque<CombiningEntry> combining;
+
+public:
+    Core(int id, uint32_t s, uint32_t E, uint32_t b) : id(id), cache(id, s, E, b) {}
+// here i am loadaing the trace files along with W and R and updating the total instructions, write instructions adn read instructions
+// addresses are read as 64 bit hex , anything above the physical address bits is cut off with a warning
+// a filtered trace from trace_filter also has # header lines and H lines for runs of private hits
+    size_t load_trace(const std::string& filename, uint32_t paddr_bits = 64) {
+        std::ifstream file(filename);
+        char op;
+        uint64_t addr;
+        size_t count = 0;
+        size_t truncated = 0;
+        uint64_t addr_mask = paddr_mask(paddr_bits);
+        while (file >> op) {
+            if (op == '#') {
+                std::string rest;
+                std::getline(file, rest);
+                continue;
+            }
+            if (op == 'H') {
+                if (!load_hit_segment(file)) {
+                    std::cerr << "Invalid hit segment in " << filename << "\n";
+                    break;
+                }
+                count += hit_segments.back().count();
+                continue;
+            }
+            if (!(file >> std::hex >> addr)) {
+                std::cerr << "Warning: " << filename << " is read up to its first malformed line\n";
+                break;
+            }
+            AccessKind kind = AccessKind::PLAIN;
+            if (op == 'A') kind = AccessKind::RMW;
+            else if (op == 'L') kind = AccessKind::LOAD_RESERVED;
+            else if (op == 'S') kind = AccessKind::STORE_CONDITIONAL;
+            else if (op != 'R' && op != 'W') {
+                std::cerr << "Invalid operation " << op << " in " << filename << "\n";
+                continue;
+            }
+            if (addr & ~addr_mask) {
+                truncated++;
+                addr &= addr_mask;
+            }
+            push_access(op == 'W' || op == 'A' || op == 'S', addr, kind);
+            count++;
+        }
+        if (truncated > 0) {
+            std::cerr << "Warning: " << truncated << " addresses in " << filename << " do not fit in "
+                      << paddr_bits << " physical address bits and were truncated\n";
+        }
+        return count;
+    }
+
+    // queues one access and counts it as a read or a write , read modify writes and store conditionals count as writes
+    void push_access(bool is_write, uint64_t addr, AccessKind kind = AccessKind::PLAIN) {
+        if (is_write) {
+            cache.stats.write_count++;
+        } else {
+            cache.stats.read_count++;
+        }
+        if (kind == AccessKind::RMW) cache.stats.atomic_count++;
+        else if (kind == AccessKind::LOAD_RESERVED) cache.stats.lr_count++;
+        else if (kind == AccessKind::STORE_CONDITIONAL) cache.stats.sc_count++;
+        has_atomics = has_atomics || kind != AccessKind::PLAIN;
+        instructions.push({addr, 0, is_write, kind});
+    }
+
+    // H <reads> <writes> <blocks> then <address> <last position> <written> for every block
+    bool load_hit_segment(std::istream& file) {
+        HitSegment segment;
+        size_t blocks = 0;
+        if (!(file >> std::dec >> segment.reads >> segment.writes >> blocks) || segment.count() == 0) return false;
+        segment.blocks.resize(blocks);
+        for (auto& block : segment.blocks) {
+            if (!(file >> std::hex >> block.address >> std::dec >> block.last_position >> block.written)) return false;
+        }
+        cache.stats.read_count += segment.reads;
+        cache.stats.write_count += segment.writes;
+        hit_segments.push_back(std::move(segment));
+        instructions.push({0, static_cast<uint32_t>(hit_segments.size()), false, AccessKind::PLAIN});
+        return true;
+    }
+
+    // it is to check if current core is stalled 
+    bool is_stalled() { return stall_cycles > 0; }
+
+    // it is check if my current core hasd further instructions to be executed or not
+    bool has_next_instruction() const {
+        return !instructions.empty() || segment_cycles_left > 0 || lock_cycles_left > 0 || (combining_entries > 0 && !combining.empty());
+    }
+
+    // the block the next access goes to if it has to wait for another core's lock , page walk reads never do
+    bool next_block(uint64_t& block) const {
+        if (instructions.empty() || walking() || instructions.front().segment != 0) return false;
+        block = instructions.front().address >> cache.offset_bits();
+        return true;
+    }
+
+    bool walking() const { return walk_next < walk_count; }
+
+    // merges a write miss into the write combining buffer , false if its block has no entry and the buffer is full
+    bool combine_write(uint64_t address) {
+        uint64_t block = address >> cache.offset_bits();
+        uint64_t word = 1ull << (((address & (cache.block_size - 1)) / STORE_BYTES) % 64);
+        for (auto& entry : combining) {
+            if (entry.block == block) {
+                entry.words |= word;
+                cache.stats.combined_writes++;
+                return true;
+            }
+        }
+        if (combining.size() >= combining_entries) return false;
+        combining.push_back({block, word});
+        return true;
+    }
+
+    uint32_t combined_bytes(const CombiningEntry& entry) const {
+        return std::min<uint32_t>(__builtin_popcountll(entry.words) * STORE_BYTES, cache.block_size);
+    }
+
+    // the BUS_WRITE that empties the oldest entry , the entry leaves the buffer when the bus takes the transaction
+    BusTransaction drain_transaction() const {
+        BusTransaction trans;
+        trans.operation = BusOperation::BUS_WRITE;
+        trans.address = combining.front().block << cache.offset_bits();
+        trans.bytes = combined_bytes(combining.front());
+        trans.drain = true;
+        trans.originating_core = id;
+        return trans;
+    }
+
+    // takes the entry of a block out of the buffer and returns its bytes , 0 if the block has none
+    uint32_t take_combined(uint64_t block) {
+        for (auto it = combining.begin(); it != combining.end(); ++it) {
+            if (it->block != block) continue;
+            uint32_t bytes = combined_bytes(*it);
+            combining.erase(it);
+            return bytes;
+        }
+        return 0;
+    }
+
+    // the page tables take the top half of physical memory , one table per level with 9 index bits per level like
+    // x86-64 , so a 4 KB page has a 4 level walk and a 2 MB page a 3 level walk with 48 physical address bits
+    void enable_tlb(const TlbConfig& config, uint32_t paddr_bits) {
+        tlb_enabled = true;
+        l1_tlb.configure(config.l1_entries, config.l1_ways);
+        l2_tlb.configure(config.l2_entries, config.l2_ways);
+        page_bits = config.page_bits;
+        walk_levels = std::min<uint32_t>(7, std::max<uint32_t>(1, (paddr_bits - page_bits + 8) / 9));
+        page_table_base = 1ull << (paddr_bits - 1);
+        page_table_level_span = 1ull << (paddr_bits - 4);
+    }
+
+    // looks up the page of the access at the front , returns false if the core has to wait for the L2 TLB
+    // an L2 TLB miss queues one read of a page table entry per level , they go through the cache and bus like any read
+    bool translate(uint64_t address) {
+        uint64_t page = address >> page_bits;
+        front_translated = true;
+        if (l1_tlb.lookup(page)) {
+            cache.stats.tlb_l1_hits++;
+            return true;
+        }
+        cache.stats.tlb_l1_misses++;
+        if (l2_tlb.lookup(page)) {
+            cache.stats.tlb_l2_hits++;
+            l1_tlb.insert(page);
+            stall_cycles = TLB_L2_HIT_CYCLES;
+            return false;
+        }
+        cache.stats.tlb_l2_misses++;
+        for (uint32_t level = 0; level < walk_levels; level++) {
+            uint64_t index = page >> (9 * (walk_levels - 1 - level));
+            walk_addresses[level] = page_table_base + level * page_table_level_span + index * 8;
+        }
+        walk_next = 0;
+        walk_count = walk_levels;
+        cache.stats.walk_references += walk_levels;
+        l2_tlb.insert(page);
+        l1_tlb.insert(page);
+        return true;
+    }
+
+    void enable_l2(const L2Config& config, uint32_t block_bits, IndexMode index_mode, bool snoop_filter) {
+        l2 = std::make_unique<Cache<>>(id, config.set_bits, config.ways, block_bits);
+        l2->index_mode = index_mode;
+        l2->spill_evictions = true;
+        if (snoop_filter) l2->presence.configure(l2->cache_lines.size());
+        inclusion = config.policy;
+        cache.spill_evictions = true;
+    }
+
+    // a block that came over the bus goes to the L1 , and to the L2 as well unless that is exclusive
+    // it returns the cycles of the writebacks this caused
+    int install_block(uint64_t address, const std::vector<uint8_t>& data, MESIState state, uint64_t* total_bus_traffic) {
+        int cycles = cache.install_block(address, data, state, total_bus_traffic);
+        if (!l2) return cycles;
+        cycles += spill_l1_victim();
+        if (inclusion != InclusionPolicy::EXCLUSIVE) cycles += fill_l2(address, state, false);
+        return cycles;
+    }
+
+    // an L1 miss that hits the L2 is filled from there without the bus , the core then waits L2_HIT_CYCLES and the
+    // access is retried as an L1 hit , a write to a shared block then sends its invalidation like any other
+    bool fill_from_l2(uint64_t address) {
+        const BlockLocation& loc = l2->locate(address);
+        CacheLine* line = l2->find_line(loc);
+        if (!line) return false;
+        l2->stats.hit_count++;
+        MESIState state = line->state;
+        bool dirty = line->dirty;
+        line->lru_counter = ++l2->current_lru_counter;
+        if (inclusion == InclusionPolicy::EXCLUSIVE) {
+            line->valid = false;
+            line->dirty = false;
+            line->state = MESIState::INVALID;
+            l2->release_tag(*line);
+            l2->presence.remove(loc.block);
+        } else {
+            // the L1 copy owns the data from now on , the L2 one is clean and never answers a snoop as modified
+            line->dirty = false;
+            if (line->state == MESIState::MODIFIED) line->state = MESIState::EXCLUSIVE;
+        }
+
+        // this fill does not use the bus , so it must not show up in the bus data traffic of the core
+        uint64_t data_traffic = cache.stats.data_traffic;
+        uint64_t unused_traffic = 0;
+        int cycles = cache.install_block(address, std::vector<uint8_t>(cache.block_size, 0), state, &unused_traffic);
+        cache.stats.data_traffic = data_traffic;
+        cache.find_line(cache.locate(address))->dirty = dirty;
+        stall_cycles = L2_HIT_CYCLES + cycles + spill_l1_victim();
+        return true;
+    }
+
+    // puts a block into the L2 or updates the copy there , a dirty block comes from the L1 and is the only copy
+    // an inclusive L2 takes its victim back from the L1 , any victim that is dirty in either level is written back
+    int fill_l2(uint64_t address, MESIState state, bool dirty) {
+        int cycles = 0;
+        CacheLine* line = l2->find_line(l2->locate(address));
+        if (!line) {
+            uint64_t unused_traffic = 0;
+            l2->install_block(address, std::vector<uint8_t>(l2->block_size, 0), state, &unused_traffic);
+            line = l2->find_line(l2->locate(address));
+            if (l2->spilled.valid) {
+                EvictedLine victim = l2->spilled;
+                l2->spilled.valid = false;
+                bool written_back = victim.dirty;
+                if (inclusion == InclusionPolicy::INCLUSIVE) {
+                    bool in_l1 = false;
+                    written_back = cache.drop_block(victim.block << cache.offset_bits(), in_l1) || written_back;
+                    if (in_l1) cache.stats.back_invalidations++;
+                }
+                if (written_back) {
+                    l2->stats.writeback_count++;
+                    cycles += 100;
+                }
+            }
+        }
+        if (dirty) {
+            line->state = MESIState::MODIFIED;
+            line->dirty = true;
+        } else {
+            line->state = state == MESIState::MODIFIED ? MESIState::EXCLUSIVE : state;
+        }
+        return cycles;
+    }
+
+    // where a line the L1 evicted goes , an exclusive L2 takes every victim and the others only take dirty ones
+    int spill_l1_victim() {
+        if (!cache.spilled.valid) return 0;
+        EvictedLine victim = cache.spilled;
+        cache.spilled.valid = false;
+        uint64_t address = victim.block << cache.offset_bits();
+        if (inclusion == InclusionPolicy::EXCLUSIVE) return fill_l2(address, victim.state, victim.dirty);
+        return victim.dirty ? fill_l2(address, MESIState::MODIFIED, true) : 0;
+    }
+
+    // the access at the front is done , which is the next page walk read if a walk is going on
+    // a load reserved sets the reservation , and so does the one a failed store conditional went back to , which leaves
+    // the store conditional at the front to be tried again , a read modify write locks its line from here on
+    // without Atomics none of the traces has an atomic access and all of that is left out
+    template <bool Atomics>
+    void retire_access() {
+        if (walking()) {
+            walk_next++;
+        } else if (!instructions.empty()) {
+            if constexpr (Atomics) {
+                const TraceAccess& front = instructions.front();
+                if (reserving || front.kind == AccessKind::LOAD_RESERVED) {
+                    cache.reservation = true;
+                    cache.reserved_block = front.address >> cache.offset_bits();
+                }
+                if (reserving) {
+                    reserving = false;
+                    return;
+                }
+                if (front.kind == AccessKind::STORE_CONDITIONAL) cache.reservation = false;
+                if (front.kind == AccessKind::RMW && lock_latency > 0) {
+                    locked_block = front.address >> cache.offset_bits();
+                    lock_cycles_left = lock_latency;
+                }
+            }
+            instructions.pop();
+            front_translated = false;
+        }
+    }
+
+    // it is called at the first and by each core , it calls access to finally  update if i got a miss or hit and returns that to run function where i process it further 
+    // WithL2 and Atomics are fixed for the run by the simulator , so the cycle of an L1 only core has no L2 code in it
+    // and without atomic accesses there is no store conditional check
+    template <bool WithL2, bool Atomics>
+    std::pair<bool, BusTransaction> cycle(bool bus_empty) {
+    if (stall_cycles >0) {
+        // cache.stats.idle_cycles++;
+        return {false, BusTransaction()};
+    }
+
+    if (instructions.empty()) {
+        // cache.stats.idle_cycles++;
+        // whatever is left in the write combining buffer goes to memory before the core is done
+        if (!combining.empty()) return {false, drain_transaction()};
+        return {false, BusTransaction()};
+    }
+
+    // a run of private hits takes one cycle per access like the real ones , the cache is brought to the state at the
+    // end of the run now and the rest of the cycles are counted off by the simulator through segment_cycles_left
+    if (instructions.front().segment != 0) {
+        const HitSegment& segment = hit_segments[instructions.front().segment - 1];
+        cache.replay_hits(segment);
+        instructions.pop();
+        cache.stats.hit_count++;
+        segment_cycles_left = segment.count() - 1;
+        pending_bus_trans.operation = BusOperation::NONE;
+        pending_bus_trans.originating_core = id;
+        return {true, pending_bus_trans};
+    }
+
+    if (tlb_enabled && !walking() && !front_translated && !translate(instructions.front().address)) {
+        return {false, BusTransaction()};
+    }
+
+    uint64_t addr = walking() ? walk_addresses[walk_next] : instructions.front().address;
+    bool is_write = !walking() && instructions.front().is_write;
+
+    // a store conditional without its reservation fails in a cycle without touching the cache
+    if constexpr (Atomics) {
+        if (!walking() && instructions.front().kind == AccessKind::STORE_CONDITIONAL) {
+            if (!reserving && !cache.reserved(addr)) {
+                cache.stats.sc_failures++;
+                cache.contention[addr >> cache.offset_bits()].failed_sc++;
+                reserving = true;
+                pending_bus_trans = BusTransaction();
+                pending_bus_trans.originating_core = id;
+                return {true, pending_bus_trans};
+            }
+            is_write = !reserving;
+        }
+    }
+    auto [hit, latency] = cache.access(addr, is_write, pending_bus_trans,bus_empty);
+
+    // a block found in the victim cache is moved back and the access is retried next cycle as a normal hit
+    if (!hit && !cache.victim_lines.empty() &&
+        (pending_bus_trans.operation == BusOperation::BUS_READ || pending_bus_trans.operation == BusOperation::BUS_READX) &&
+        cache.swap_from_victim(addr)) {
+        stall_cycles = VICTIM_HIT_CYCLES;
+        return {false, BusTransaction()};
+    }
+
+    if constexpr (WithL2) {
+        if (!hit &&
+            (pending_bus_trans.operation == BusOperation::BUS_READ || pending_bus_trans.operation == BusOperation::BUS_READX) &&
+            fill_from_l2(addr)) {
+            return {false, BusTransaction()};
+        }
+    }
+
+    // a write miss that is not allocated is merged into the write combining buffer without the bus , only a full
+    // buffer has to drain its oldest entry first and the write is tried again after that
+    if (!hit && combining_entries > 0 && pending_bus_trans.operation == BusOperation::BUS_WRITE) {
+        if (!combine_write(addr)) return {false, drain_transaction()};
+        retire_access<Atomics>();
+        cache.stats.miss_count++;
+        cache.record_miss(addr);
+        pending_bus_trans = BusTransaction();
+        pending_bus_trans.originating_core = id;
+        return {true, pending_bus_trans};
+    }
+
+    // returning updated state both in acse of hit and miss
+    if (hit) {
+        retire_access<Atomics>();
+        cache.stats.hit_count++;
+        cache.record_hit(addr);
+        pending_bus_trans.originating_core = id;
+        return {true, pending_bus_trans};
+    } else {
+        pending_bus_trans.originating_core = id;
+        // waiting_for_bus = true;
+        return {false,pending_bus_trans};
+    }
+}
+
+    int get_id() const { return id; }
+};
+
+
+// this is the main simulator class which includes all the cores and the bus transactions and the global cycle and the stats for each core
+// this is the main class which runs the simulation and handles the bus transactions and the cores and also the stats
+// in my bus i can contain only one instruction at a time 
+template <class CacheT = Cache<>>
+class Simulator {
+public:
+    std::vector<Core<CacheT>> cores;
+    std::queue<BusTransaction> bus_queue;
+    BusTransaction current_bus_trans;
+    int bus_busy_cycles = 0;
+    uint64_t global_cycle = 0;
+    uint64_t total_bus_transactions = 0;
+    uint64_t total_invalidations = 0;
+    uint64_t total_bus_traffic = 0;
+    // snoops each core answered and the ones its presence filter let the bus skip
+    uint64_t snoops_performed[4] = {};
+    uint64_t snoops_filtered[4] = {};
+    // bus transactions that were snooped by the other cores
+    uint64_t snooped_transactions = 0;
+    // if any core has an atomic access , set as they are queued so the cycle loop without the lock checks can be picked
+    bool atomics = false;
+    // with sockets the bus members above are the bus of the socket being stepped , the others wait here
+    SocketBus socket_buses[4];
+    std::unordered_map<uint64_t, uint32_t> page_homes;
+    uint64_t link_free_cycle = 0;
+    uint64_t link_transfers = 0;
+    uint64_t link_bytes = 0;
+    uint64_t link_busy_cycles = 0;
+    std::string trace_prefix;
+    uint32_t set_index_bits;
+    uint32_t associativity;
+    uint32_t block_bits;
+    uint32_t block_size;
+    // what one bus transfer moves , the block or with sectors just one sector
+    uint32_t transfer_size;
+    uint32_t num_sets;
+    double cache_size_kb;
+    SimOptions options;
+    // interval sampling state , only touched when options.interval_cycles is set
+    std::ofstream timeseries_out;
+    bool timeseries_binary = false;
+    uint64_t interval_start = 0;
+    uint64_t interval_bus_busy = 0;
+    uint64_t interval_queue_depth = 0;
+    CoreStats interval_base[4];
+
+public:
+// here it calls each core to set up its cacahe and load the traces
+    Simulator(uint32_t s, uint32_t E, uint32_t b, const std::vector<std::string>& trace_files, const std::string& prefix,
+              const SimOptions& opts = SimOptions())
+        : Simulator(s, E, b, opts) {
+        trace_prefix = prefix;
+        for (int i = 0; i < 4; i++) {
+            cores[i].load_trace(trace_files[i], options.paddr_bits);
+            atomics = atomics || cores[i].has_atomics;
+        }
+    }
+
+    // a simulator with empty cores , the accesses are pushed in from memory with push_access or push_accesses
+    Simulator(uint32_t s, uint32_t E, uint32_t b, const SimOptions& opts = SimOptions())
+        : set_index_bits(s), associativity(E), block_bits(b), block_size(1 << b),
+          transfer_size((1 << b) / std::max<uint32_t>(opts.sectors, 1)), num_sets(1 << s), cache_size_kb((1 << s) * E * (1 << b) / 1024.0), options(opts) {
+        for (int i = 0; i < 4; i++) {
+            cores.emplace_back(i, s, E, b);
+            if (options.classify_misses) cores[i].cache.enable_miss_classifier();
+            if (options.victim_entries > 0) cores[i].cache.enable_victim_cache(options.victim_entries);
+            cores[i].cache.index_mode = options.index_mode;
+            if (!options.set_heatmap_file.empty()) cores[i].cache.set_stats.resize(num_sets);
+            if (options.tlb.enabled()) cores[i].enable_tlb(options.tlb, options.paddr_bits);
+            if (options.snoop_filter) cores[i].cache.presence.configure(num_sets * E + options.victim_entries);
+            cores[i].cache.profiling = options.profile;
+            if (options.l2.enabled()) cores[i].enable_l2(options.l2, b, options.index_mode, options.snoop_filter);
+            if (options.sectors > 1) cores[i].cache.enable_sectors(options.sectors);
+            if (options.protocol != CoherenceProtocol::MESI) cores[i].cache.enable_update_protocol(options.protocol);
+            cores[i].lock_latency = options.lock_latency;
+            cores[i].cache.write_through = options.write_through;
+            cores[i].cache.write_allocate = options.write_allocate;
+            cores[i].combining_entries = options.combining_entries;
+        }
+        if (options.interval_cycles > 0) open_timeseries();
+    }
+
+    // accesses can be added at any time , also after run() has finished , and the next step() or run() carries on
+    // addresses wider than the physical address bits are cut down like in the trace files
+    void push_access(int core, bool is_write, uint64_t address, AccessKind kind = AccessKind::PLAIN) {
+        if (options.paddr_bits < 64) address &= (1ull << options.paddr_bits) - 1;
+        cores[core].push_access(is_write, address, kind);
+        atomics = atomics || kind != AccessKind::PLAIN;
+    }
+
+    void push_accesses(int core, const Access* accesses, size_t count) {
+        for (size_t i = 0; i < count; i++) push_access(core, accesses[i].is_write, accesses[i].address, accesses[i].kind);
+    }
+
+    // starts the counting over and keeps the caches as they are , for measuring a region after a warm up
+    void reset_stats() {
+        for (auto& core : cores) {
+            core.cache.stats = CoreStats();
+            if (core.l2) core.l2->stats = CoreStats();
+        }
+        total_bus_transactions = 0;
+        total_invalidations = 0;
+        total_bus_traffic = 0;
+        snooped_transactions = 0;
+        for (int i = 0; i < 4; i++) snoops_performed[i] = snoops_filtered[i] = 0;
+        link_transfers = link_bytes = link_busy_cycles = 0;
+    }
+
+    const CoreStats& core_stats(int core) const { return cores[core].cache.stats; }
+
+    // the time series has one row per interval of interval_cycles cycles
+    // a .bin file gets the same fields as raw uint64 values , 5 + 4 per record in the order of the csv header
+    void open_timeseries() {
+        const std::string& name = options.timeseries_file;
+        timeseries_binary = name.size() >= 4 && name.compare(name.size() - 4, 4, ".bin") == 0;
+        timeseries_out.open(name, timeseries_binary ? std::ios::binary : std::ios::out);
+        if (!timeseries_out) {
+            std::cerr << "Error: Cannot open time series file " << name << "\n";
+            options.interval_cycles = 0;
+            return;
+        }
+        if (!timeseries_binary) {
+            timeseries_out << "End_Cycle,Bus_Busy_Cycles,Bus_Utilization,Avg_Queue_Depth,Accesses,Misses,Miss_Rate";
+            for (int i = 0; i < 4; i++) timeseries_out << ",Core" << i << "_Idle_Cycles";
+            timeseries_out << "\n";
+        }
+    }
+
+    // called every cycle while sampling , before the bus stage
+    void sample_bus() {
+        if (bus_busy_cycles > 0) interval_bus_busy++;
+        interval_queue_depth += bus_queue.size();
+    }
+
+    void write_interval() {
+        uint64_t length = global_cycle - interval_start;
+        if (length == 0) return;
+        uint64_t accesses = 0, misses = 0;
+        uint64_t idle[4];
+        for (int i = 0; i < 4; i++) {
+            const CoreStats& now = cores[i].cache.stats;
+            accesses += (now.hit_count + now.miss_count) - (interval_base[i].hit_count + interval_base[i].miss_count);
+            misses += now.miss_count - interval_base[i].miss_count;
+            idle[i] = now.idle_cycles - interval_base[i].idle_cycles;
+            interval_base[i] = now;
+        }
+        if (timeseries_binary) {
+            uint64_t record[9] = {global_cycle, interval_bus_busy, interval_queue_depth, accesses, misses,
+                                  idle[0], idle[1], idle[2], idle[3]};
+            timeseries_out.write(reinterpret_cast<const char*>(record), sizeof(record));
+        } else {
+            timeseries_out << global_cycle << "," << interval_bus_busy << ","
+                           << std::fixed << std::setprecision(4) << (double)interval_bus_busy / length << ","
+                           << (double)interval_queue_depth / length << ","
+                           << accesses << "," << misses << ","
+                           << std::setprecision(2) << (accesses > 0 ? (double)misses / accesses * 100 : 0);
+            for (int i = 0; i < 4; i++) timeseries_out << "," << idle[i];
+            timeseries_out << "\n";
+        }
+        interval_start = global_cycle;
+        interval_bus_busy = 0;
+        interval_queue_depth = 0;
+    }
+
+    // heatmap of the sets of every core , one row per core and set
+    void write_set_heatmap(std::ostream& out) const {
+        out << "Core,Set,Accesses,Misses,Evictions\n";
+        for (int i = 0; i < 4; i++) {
+            const auto& set_stats = cores[i].cache.set_stats;
+            for (size_t set = 0; set < set_stats.size(); set++) {
+                out << i << "," << set << ","
+                    << set_stats[set].accesses << ","
+                    << set_stats[set].misses << ","
+                    << set_stats[set].evictions << "\n";
+            }
+        }
+    }
+// it is to check at last if all cores are finished 
+    bool has_atomics() const { return atomics; }
+
+    // the core whose locked line the next access of this core goes to , -1 if it can go ahead
+    int lock_holder(const Core<CacheT>& core) const {
+        uint64_t block;
+        if (!core.next_block(block)) return -1;
+        for (const auto& other : cores) {
+            if (other.lock_cycles_left > 0 && other.locked_block == block && other.get_id() != core.get_id()) return other.get_id();
+        }
+        return -1;
+    }
+
+    // the blocks with the most contention over all cores , most waited for first
+    std::vector<std::pair<uint64_t, BlockContention>> hot_blocks(size_t count) const {
+        std::unordered_map<uint64_t, BlockContention> merged;
+        for (const auto& core : cores) {
+            for (const auto& [block, contention] : core.cache.contention) {
+                merged[block].cycles += contention.cycles;
+                merged[block].failed_sc += contention.failed_sc;
+            }
+        }
+        std::vector<std::pair<uint64_t, BlockContention>> blocks(merged.begin(), merged.end());
+        std::sort(blocks.begin(), blocks.end(), [](const auto& a, const auto& b) {
+            if (a.second.cycles != b.second.cycles) return a.second.cycles > b.second.cycles;
+            if (a.second.failed_sc != b.second.failed_sc) return a.second.failed_sc > b.second.failed_sc;
+            return a.first < b.first;
+        });
+        if (blocks.size() > count) blocks.resize(count);
+        return blocks;
+    }
+
+    bool all_cores_finished() const {
+        for (const auto& core : cores) {
+            if (core.has_next_instruction()) return false;
+        }
+        for (uint32_t s = 1; s < options.numa.sockets; s++) {
+            if (!socket_buses[s].queue.empty() || socket_buses[s].busy_cycles != 0) return false;
+        }
+        return bus_queue.empty() && bus_busy_cycles == 0;
+    }
+
+    uint32_t socket_of(int core) const { return core / (cores.size() / options.numa.sockets); }
+
+    // the socket whose memory holds the page of the address , a first touch homes the page with the requesting core
+    uint32_t home_socket(uint64_t address, int requester) {
+        uint64_t page = address >> options.numa.page_bits;
+        if (options.numa.home == HomePolicy::INTERLEAVE) return page % options.numa.sockets;
+        return page_homes.emplace(page, socket_of(requester)).first->second;
+    }
+
+    // the cycles until bytes have crossed the link , counting the wait for the transfers ahead of it
+    int link_transfer(uint32_t bytes) {
+        uint64_t start = std::max(global_cycle, link_free_cycle);
+        uint64_t busy = (bytes + options.numa.link_bytes_per_cycle - 1) / options.numa.link_bytes_per_cycle;
+        link_free_cycle = start + busy;
+        link_transfers++;
+        link_bytes += bytes;
+        link_busy_cycles += busy;
+        return static_cast<int>(start - global_cycle + options.numa.link_latency + busy);
+    }
+
+    void swap_bus(SocketBus& bus) {
+        std::swap(bus_queue, bus.queue);
+        std::swap(current_bus_trans, bus.current);
+        std::swap(bus_busy_cycles, bus.busy_cycles);
+    }
+
+    // one core snooping a transaction , a core whose presence filter rules the block out is not probed at all
+    void snoop(Core<CacheT>& core, BusTransaction& trans, BusTransaction& response) {
+        int id = core.get_id();
+        uint64_t block = trans.address >> block_bits;
+        if (options.snoop_filter && !core.cache.presence.may_contain(block) &&
+            !(core.l2 && core.l2->presence.may_contain(block))) {
+            snoops_filtered[id]++;
+            return;
+        }
+        snoops_performed[id]++;
+        SnoopResult l1_result = core.cache.handle_bus_transaction(trans, response);
+        SnoopResult l2_result = core.l2 ? snoop_l2(core, trans, response) : SnoopResult::MISSED;
+        // a core on another socket counts once if either level lost its copy and neither level kept one
+        if (options.numa.enabled() && socket_of(id) != socket_of(trans.originating_core) &&
+            (l1_result == SnoopResult::INVALIDATED || l2_result == SnoopResult::INVALIDATED) &&
+            l1_result != SnoopResult::KEPT && l2_result != SnoopResult::KEPT) {
+            cores[trans.originating_core].cache.stats.cross_socket_invalidations++;
+        }
+    }
+
+    // the L2 side of a snoop , kept out of snoop() so the L1 only path stays as small as it was
+    // both levels react , the modified copy of the L1 is the one that answers if there is one
+    SnoopResult snoop_l2(Core<CacheT>& core, BusTransaction& trans, BusTransaction& response) {
+        BusTransaction l2_response;
+        SnoopResult result = core.l2->handle_bus_transaction(trans, l2_response);
+        if (response.operation != BusOperation::FLUSH && l2_response.operation == BusOperation::FLUSH) {
+            response = l2_response;
+        } else if (response.data.empty() && !l2_response.data.empty()) {
+            response.data = l2_response.data;
+        }
+        return result;
+    }
+
+    // sends the written word to every other core and returns the shared line , the writer pays for the word on the bus
+    bool broadcast_update(BusTransaction& trans) {
+        BusTransaction update = trans;
+        update.operation = BusOperation::BUS_UPDATE;
+        bool shared = false;
+        for (auto& core : cores) {
+            if (core.get_id() == trans.originating_core) continue;
+            BusTransaction response;
+            snoop(core, update, response);
+            shared = shared || response.shared;
+        }
+        auto& writer = cores[trans.originating_core].cache.stats;
+        writer.update_broadcasts++;
+        writer.data_traffic += UPDATE_WORD_BYTES*8;
+        total_bus_traffic += UPDATE_WORD_BYTES*8;
+        return shared;
+    }
+
+    // bytes of a core posted to memory , the cycles they take on the bus are returned for the caller to charge
+    int post_write(int core, uint32_t bytes) {
+        CoreStats& stats = cores[core].cache.stats;
+        stats.memory_writes++;
+        stats.memory_write_bytes += bytes;
+        stats.data_traffic += bytes*8;
+        total_bus_traffic += bytes*8;
+        return POSTED_WRITE_CYCLES_PER_WORD * ((bytes + STORE_BYTES - 1) / STORE_BYTES);
+    }
+
+    // a BUS_WRITE , the other copies go like for a BUS_READX and a modified one is flushed before memory takes the bytes
+    int bus_write(const BusTransaction& trans) {
+        int cycles = 0;
+        snooped_transactions++;
+        BusTransaction write = trans;
+        for (auto& core : cores) {
+            if (core.get_id() == trans.originating_core) continue;
+            BusTransaction response;
+            snoop(core, write, response);
+            if (response.operation == BusOperation::FLUSH) {
+                cycles += 100;
+                core.stall_cycles = std::max(core.stall_cycles, 100);
+                core.cache.stats.data_traffic += transfer_size*8;
+                total_bus_traffic += transfer_size*8;
+            }
+        }
+        cycles += post_write(trans.originating_core, trans.bytes);
+        cores[trans.originating_core].cache.stats.write_stall_cycles += cycles;
+        return cycles;
+    }
+
+    // memory has to be up to date before it answers a miss , so any write combining entry of the block is drained first
+    int drain_combined(uint64_t address) {
+        int cycles = 0;
+        for (auto& core : cores) {
+            uint32_t bytes = core.take_combined(address >> block_bits);
+            if (bytes > 0) cycles += post_write(core.get_id(), bytes);
+        }
+        cores[current_bus_trans.originating_core].cache.stats.write_stall_cycles += cycles;
+        return cycles;
+    }
+
+    // the extra cycles of a miss that has to cross the link , a block from a cache on another socket comes over the link
+    // and a block from the memory of another socket needs the request to go over first
+    int numa_cycles(bool data_provided, int provider) {
+        int requester = current_bus_trans.originating_core;
+        CoreStats& stats = cores[requester].cache.stats;
+        int extra = 0;
+        if (data_provided) {
+            if (socket_of(provider) != socket_of(requester)) {
+                stats.remote_cache_fills++;
+                extra = link_transfer(transfer_size);
+            }
+        } else if (home_socket(current_bus_trans.address, requester) != socket_of(requester)) {
+            stats.numa_remote_misses++;
+            extra = options.numa.link_latency + link_transfer(transfer_size);
+        } else {
+            stats.numa_local_misses++;
+        }
+        cores[requester].stall_cycles += extra;
+        return extra;
+    }
+
+    // it is to handle the bus read and update the stats accordingly and also check for the data provided or not
+    // it calls handle_bus_transactions adn it tellls it what to do, it accordingly updates the bus_busy_cyclre adn stall cyles for the required cores and also the data traffic
+    // it also updates the final state of the cache line and also the data provided if any
+    int handle_bus_read() {
+        bool data_provided = false;
+        std::vector<uint8_t> response_data;
+        MESIState final_state = MESIState::SHARED;
+        int total_cycles = 0;
+        int installing_cycles=0;
+        int provider = -1;
+        snooped_transactions++;
+        if (options.combining_entries > 0) total_cycles += drain_combined(current_bus_trans.address);
+
+        for (auto& core : cores) {
+            if (core.get_id() == current_bus_trans.originating_core) {
+
+                if(current_bus_trans.operation == BusOperation::INVALIDATE){
+                    total_invalidations++;
+                    cores[current_bus_trans.originating_core].cache.stats.invalidations++;
+                    total_bus_transactions++;
+                    cores[current_bus_trans.originating_core].instructions.pop();
+                    // cores[current_bus_trans.originating_core].waiting_for_bus = false;
+                }
+                continue;
+            }
+            BusTransaction response;
+            snoop(core, current_bus_trans, response);
+
+            if (current_bus_trans.operation == BusOperation::BUS_READ) {
+                if (response.operation == BusOperation::FLUSH) {
+                    response_data = response.data;
+                    data_provided = true;
+                    provider = core.get_id();
+                    // a snooped core can have a miss of its own in flight on another socket's bus , it must not wake up
+                    // before that miss is done , so its stall is only ever made longer here and below
+                    core.stall_cycles = std::max(core.stall_cycles, 100 + 2*(int)(transfer_size / 4));
+                    core.cache.stats.data_traffic += transfer_size*8;
+                    cores[current_bus_trans.originating_core].stall_cycles = 2*(transfer_size / 4);
+                    total_cycles += 100 + 2 * (transfer_size / 4);
+                    final_state = MESIState::SHARED;
+                    total_bus_traffic += transfer_size*8;
+                    break;
+                } else if (!response.data.empty()) {
+                    response_data = response.data;
+                    data_provided = true;
+                    provider = core.get_id();
+                    total_cycles += 2 * (transfer_size / 4);
+                    core.cache.stats.data_traffic += transfer_size*8;
+                    cores[current_bus_trans.originating_core].cache.stats.data_traffic += transfer_size*8;
+                    core.stall_cycles = std::max(core.stall_cycles, 2*(int)(transfer_size / 4));
+                    cores[current_bus_trans.originating_core].stall_cycles = 2*(transfer_size / 4);
+                    final_state = MESIState::SHARED;
+                    // total_bus_traffic += block_size;
+                    break;
+                }
+            } else if (current_bus_trans.operation == BusOperation::BUS_READX) {
+                if (response.operation == BusOperation::FLUSH) {
+                    total_cycles += 100;
+                    core.stall_cycles = std::max(core.stall_cycles, 100);  // dusra core ko next 100 ke liye stall karna hai just chaneg it after wards 
+                    core.cache.stats.data_traffic += transfer_size*8;
+                    cores[current_bus_trans.originating_core].stall_cycles=100;
+                    total_bus_traffic += transfer_size*8;
+                }
+                final_state = MESIState::MODIFIED;
+            }
+ 
+        }
+        if(current_bus_trans.operation != BusOperation::INVALIDATE){
+        if (!data_provided) {
+            // if(current_bus_trans.originating_core ==0){
+            //     printf(" i am here\n");
+            // }
+            response_data = std::vector<uint8_t>(block_size, 0);
+            total_cycles += 100;
+            cores[current_bus_trans.originating_core].cache.stats.data_traffic += transfer_size*8;
+            cores[current_bus_trans.originating_core].stall_cycles += 100;
+            final_state = (current_bus_trans.operation == BusOperation::BUS_READX) ? 
+                          MESIState::MODIFIED : MESIState::EXCLUSIVE;
+            total_bus_traffic += transfer_size;
+        }
+
+        if (options.numa.enabled()) total_cycles += numa_cycles(data_provided, provider);
+
+        // a write through write miss brings the block in like a write back one , then posts its word and stays clean
+        if (options.write_through && current_bus_trans.operation == BusOperation::BUS_READX) {
+            final_state = MESIState::EXCLUSIVE;
+            int cycles = post_write(current_bus_trans.originating_core, STORE_BYTES);
+            cores[current_bus_trans.originating_core].cache.stats.write_stall_cycles += cycles;
+            total_cycles += cycles;
+        }
+
+        // under an update protocol a write miss is a read , and the word goes to the copies that supplied the block
+        bool shared = current_bus_trans.write_miss && data_provided;
+        if (current_bus_trans.write_miss && !data_provided) final_state = MESIState::MODIFIED;
+
+        installing_cycles += cores[current_bus_trans.originating_core].install_block(
+            current_bus_trans.address, response_data, final_state, & total_bus_traffic);
+        total_cycles += installing_cycles;
+        cores[current_bus_trans.originating_core].stall_cycles += installing_cycles;
+
+        if (current_bus_trans.write_miss) {
+            if (shared) {
+                shared = broadcast_update(current_bus_trans);
+                total_cycles += UPDATE_CYCLES;
+            }
+            cores[current_bus_trans.originating_core].cache.settle_write(current_bus_trans.address, shared, shared);
+        }
+
+        }
+
+        return total_cycles;
+    }
+
+    // this is the main function which runs the simulation and handles the bus transactions and the cores and also the stats
+    // the cycle loop is picked once for the whole run
+    void run() {
+        StepFunction step_function = pick_step();
+        while ((this->*step_function)()) {}
+        if (options.interval_cycles > 0) write_interval();
+        // for (auto& core : cores) {
+        //     core.cache.stats.total_cycles = global_cycle;
+        // }
+
+    }
+
+    // this is one cycle of all the cores and the bus , it returns false without doing anything once everything is done
+    bool step() { return (this->*pick_step())(); }
+
+    // the cycle loop for this run , the L2 and the atomics are compiled in only when the run has them
+    // accesses pushed later can bring atomics in , so this is picked again by every run() and step()
+    using StepFunction = bool (Simulator::*)();
+    StepFunction pick_step() const {
+        if (options.l2.enabled()) return atomics ? &Simulator::step_cycle<true, true> : &Simulator::step_cycle<true, false>;
+        return atomics ? &Simulator::step_cycle<false, true> : &Simulator::step_cycle<false, false>;
+    }
+
+    // one cycle as step()
+    template <bool WithL2, bool Atomics>
+    bool step_cycle() {
+        if (all_cores_finished()) return false;
+        if (!options.numa.enabled()) {
+            step_socket<WithL2, Atomics>(0, cores.size());
+        } else {
+            size_t per_socket = cores.size() / options.numa.sockets;
+            for (uint32_t s = 0; s < options.numa.sockets; s++) {
+                if (s > 0) swap_bus(socket_buses[s]);
+                step_socket<WithL2, Atomics>(s * per_socket, (s + 1) * per_socket);
+                if (s > 0) swap_bus(socket_buses[s]);
+            }
+        }
+        global_cycle++;
+        if (options.interval_cycles > 0 && global_cycle - interval_start == options.interval_cycles) write_interval();
+        return true;
+    }
+
+    // one cycle of the cores from first up to last and of the bus they are on
+    template <bool WithL2, bool Atomics>
+    void step_socket(size_t first, size_t last) {
+        // picking up each core 
+        for (size_t c = first; c < last; c++) {
+            auto& core = cores[c];
+            // if it is waiting for bus , i need to update the idle cycles
+            if(core.waiting_for_bus){
+                core.cache.stats.idle_cycles++;
+                if (options.profile) core.cache.profile.bus_wait_spins++;
+            }
+            // a walk started in the cycle of its translation , so counting here from the next cycle on gives its length
+            if (options.tlb.enabled() && core.walking()) core.cache.stats.walk_cycles++;
+            // if(core.get_id()==0 &&core.stall_cycles>0){
+            //     printf("%ld %d %d\n" , global_cycle, core.stall_cycles,bus_busy_cycles);
+            // }
+            // the core holds its locked line while the read modify write finishes
+            if (Atomics && core.lock_cycles_left > 0) {
+                core.lock_cycles_left--;
+                core.cache.stats.lock_cycles++;
+                core.cache.stats.total_cycles++;
+                continue;
+            }
+            // if the core is stalled , i wont be processing it and that would count in execution since stalling heer means when it is transfering block or is reading from memory 
+            if (core.is_stalled()){
+                if (options.profile) core.cache.profile.stall_spins++;
+                core.stall_cycles--;
+                // core.cache.stats.idle_cycles++;
+                core.cache.stats.total_cycles++;
+                continue;
+            }
+
+            // the rest of a replayed run of private hits , one hit per cycle
+            if (core.segment_cycles_left > 0) {
+                core.segment_cycles_left--;
+                core.cache.stats.hit_count++;
+                core.cache.stats.total_cycles++;
+                continue;
+            }
+
+            // an access to a line another core holds locked waits for the lock to go
+            if (Atomics && lock_holder(core) >= 0) {
+                uint64_t block = 0;
+                core.next_block(block);
+                core.cache.contention[block].cycles++;
+                core.cache.stats.contention_cycles++;
+                if (!core.waiting_for_bus) core.cache.stats.idle_cycles++;
+                continue;
+            }
+
+            // a finished core has nothing to try , and without atomics a core that found the bus taken would only find
+            // the same miss again while it stays taken (snoops can take lines away but never bring one in) , so it
+            // tries again once the bus is free , a drain is not skipped since a snoop can empty the combining entry
+            if (!core.has_next_instruction()) continue;
+            if constexpr (!Atomics) {
+                if (core.bus_blocked && !bus_queue.empty()) continue;
+            }
+            core.bus_blocked = false;
+
+            // here i send  it to cycle to check for hit or miss
+            auto [progress, bus_trans] = core.template cycle<WithL2, Atomics>(bus_queue.empty());
+            // here i got a miss -> in this case i only need to update the invalidate operation and for that i will get the miss only if the bus is empty 
+            // i reach to each core adn invalidate if the block is present there
+            if(progress  && bus_trans.originating_core != -1){
+                core.cache.stats.total_cycles++;
+                if (bus_trans.operation == BusOperation::INVALIDATE) {
+                    bus_queue.push(bus_trans);
+                    bus_busy_cycles=1;
+                    total_bus_transactions++;
+                    snooped_transactions++;
+                    for (auto& other_core : cores) {
+                        if (other_core.get_id() != bus_trans.originating_core) {
+                            BusTransaction response;
+                            snoop(other_core, bus_trans, response);
+                        }
+                    }
+                    total_invalidations++;
+                    cores[bus_trans.originating_core].cache.stats.invalidations++;
+                    cores[bus_trans.originating_core].stall_cycles=0;
+                    // cores[bus_trans.originating_core].instructions.pop();
+                    // cores[bus_trans.originating_core].waiting_for_bus = false;
+                    cores[bus_trans.originating_core].pending_bus_trans = BusTransaction();
+                    
+                } else if (bus_trans.operation == BusOperation::BUS_UPDATE) {
+                    // the write hit a shared line , it is done and the bus carries its word for UPDATE_CYCLES
+                    bus_queue.push(bus_trans);
+                    bus_busy_cycles = UPDATE_CYCLES;
+                    total_bus_transactions++;
+                    snooped_transactions++;
+                    bool shared = broadcast_update(bus_trans);
+                    core.cache.settle_write(bus_trans.address, shared, true);
+                    core.pending_bus_trans = BusTransaction();
+                } else if (bus_trans.operation == BusOperation::BUS_WRITE) {
+                    // the write through hit is done in the cache , the core waits while its word goes to memory
+                    bus_queue.push(bus_trans);
+                    total_bus_transactions++;
+                    bus_busy_cycles = bus_write(bus_trans);
+                    core.stall_cycles = bus_busy_cycles;
+                    core.pending_bus_trans = BusTransaction();
+                }
+
+            }
+            // heer if i got a miss , i check i my bus is empty or not , if not i declare that it will now wait for bus and if yes it gets loaded ont he bus 
+            else if (!progress && bus_trans.originating_core != -1) {
+                // if(core.get_id()==0){
+                //     printf("%ld %d" , global_cycle, core.stall_cycles);
+                // }
+                    if (bus_queue.empty()){
+                    if (bus_trans.drain) {
+                        core.combining.pop_front();
+                    } else {
+                        core.cache.stats.miss_count++;
+                        if constexpr (WithL2) core.l2->stats.miss_count++;
+                        core.cache.record_miss(bus_trans.address);
+                    }
+                    bus_queue.push(bus_trans);
+                    total_bus_transactions++;
+                    core.waiting_for_bus = false ;
+                    }
+                    else {
+                        // printf("Core %d: Waiting for bus\n", core.get_id());
+                        core.waiting_for_bus = true;
+                        core.bus_blocked = !bus_trans.drain;
+                    }
+            }
+        }
+
+        if (options.interval_cycles > 0) sample_bus();
+
+// here bus operates on the transactions and if it was last cycle of bus it updaets teh instruction adn pops it out since it is now processed 
+        if (bus_busy_cycles > 0) {
+            bus_busy_cycles--;
+            if (bus_busy_cycles == 0 && current_bus_trans.originating_core != -1) {
+                    bus_queue.pop();
+                    auto& core = cores[current_bus_trans.originating_core];
+                    if (!current_bus_trans.drain) core.template retire_access<Atomics>();
+                    // core.waiting_for_bus = false;
+                    core.stall_cycles=0;
+                    current_bus_trans = BusTransaction();
+                }
+            else if (!bus_queue.empty() && bus_busy_cycles == 0 ) {
+                bus_queue.pop();
+            }
+        } 
+         // here it is when the bus first fetches the bus instruction and checks fo tit , snoops for it and next state are updated accordingly 
+        else if (!bus_queue.empty() && bus_busy_cycles == 0) {
+            current_bus_trans = bus_queue.front();
+            // bus_queue.pop();
+            if (current_bus_trans.originating_core < 0 || current_bus_trans.originating_core >= 4) {
+                std::cerr << "Invalid originating core " << current_bus_trans.originating_core << "\n";
+                return;
+            }
+            switch (current_bus_trans.operation) {
+                case BusOperation::INVALIDATE:
+                    break;
+                case BusOperation::BUS_READ:
+                case BusOperation::BUS_READX:
+                    bus_busy_cycles = handle_bus_read();
+                    cores[current_bus_trans.originating_core].stall_cycles=bus_busy_cycles;
+                    cores[current_bus_trans.originating_core].cache.stats.data_traffic += transfer_size*8;
+                    total_bus_traffic += transfer_size*8;
+                    break;
+                case BusOperation::BUS_WRITE:
+                    bus_busy_cycles = bus_write(current_bus_trans);
+                    cores[current_bus_trans.originating_core].stall_cycles = bus_busy_cycles;
+                    break;
+                case BusOperation::FLUSH:
+                    bus_busy_cycles = 100;
+                    cores[current_bus_trans.originating_core].stall_cycles=bus_busy_cycles;
+                    cores[current_bus_trans.originating_core].cache.stats.data_traffic += transfer_size*8;   
+                    total_bus_traffic += transfer_size*8;
+                    break;
+                default:
+                    std::cerr << "Invalid bus operation\n";
+                    break;
+            }
+        }
+    }
+
+// updating the max execution time for each core and returning the max cycles
+    uint64_t get_max_execution_time() const {
+            uint64_t max_cycles = 0;
+            for (const auto& core : cores) {
+                max_cycles = std::max(max_cycles, core.cache.stats.total_cycles+core.cache.stats.idle_cycles);
+            }
+            return max_cycles;
+        }
+// this is used to print the stats in csv format or normal format as required
+// it includes all the parameters and the stats for each core and also the overall bus summary
+    void print_stats(std::ostream& out, bool csv_format) const {
+    if (csv_format) {
+        out << "Parameter,Value\n";
+        out << "Trace_Prefix," << trace_prefix << "\n";
+        out << "Set_Index_Bits," << set_index_bits << "\n";
+        out << "Associativity," << associativity << "\n";
+        out << "Block_Bits," << block_bits << "\n";
+        out << "Block_Size_Bytes," << block_size << "\n";
+        out << "Number_of_Sets," << num_sets << "\n";
+        out << "Cache_Size_KB_per_core," << std::fixed << std::setprecision(2) << cache_size_kb << "\n";
+        if (options.protocol == CoherenceProtocol::MESI) out << "MESI_Protocol,Enabled\n";
+        else out << "Coherence_Protocol," << protocol_name(options.protocol) << "\n";
+        out << "Write_Policy," << write_policy_name(options, " ") << "\n";
+        out << "Replacement_Policy,LRU\n";
+        if (options.index_mode != IndexMode::MODULO) out << "Index_Function," << index_mode_name(options.index_mode) << "\n";
+        out << "Bus,Central snooping bus\n";
+        out << "\nCore,Total_Instructions,Reads,Writes,Total_Execution_Cycles,Idle_Cycles,Misses,Miss_Rate,Evictions,Writebacks,Invalidations,Data_Traffic\n";
+        for (int i = 0; i < 4; i++) {
+            const auto& stats = cores[i].cache.stats;
+            uint64_t total_instructions = stats.read_count + stats.write_count;
+            double miss_rate = (stats.hit_count + stats.miss_count) > 0 ?
+                (double)stats.miss_count / (stats.hit_count + stats.miss_count) * 100 : 0;
+            out << i << ","
+                << total_instructions << ","
+                << stats.read_count << ","
+                << stats.write_count << ","
+                << stats.total_cycles << ","
+                << stats.idle_cycles << ","
+                << stats.miss_count << ","
+                << std::fixed << std::setprecision(2) << miss_rate << ","
+                << stats.eviction_count << ","
+                << stats.writeback_count << ","
+                << stats.invalidations << ","
+                << stats.data_traffic << "\n";
+        }
+        if (options.classify_misses) {
+            out << "\nCore,Compulsory_Misses,Capacity_Misses,Conflict_Misses,Coherence_Misses\n";
+            for (int i = 0; i < 4; i++) {
+                const auto& stats = cores[i].cache.stats;
+                out << i << ","
+                    << stats.compulsory_misses << ","
+                    << stats.capacity_misses << ","
+                    << stats.conflict_misses << ","
+                    << stats.coherence_misses << "\n";
+            }
+        }
+        if (options.victim_entries > 0) {
+            out << "\nCore,Victim_Entries,Victim_Probes,Victim_Hits,Victim_Hit_Rate,Victim_Cycles_Saved\n";
+            for (int i = 0; i < 4; i++) {
+                const auto& stats = cores[i].cache.stats;
+                uint64_t probes = stats.victim_hits + stats.miss_count;
+                double hit_rate = probes > 0 ? (double)stats.victim_hits / probes * 100 : 0;
+                out << i << ","
+                    << options.victim_entries << ","
+                    << probes << ","
+                    << stats.victim_hits << ","
+                    << std::fixed << std::setprecision(2) << hit_rate << ","
+                    << stats.victim_cycles_saved << "\n";
+            }
+        }
+        if (options.tlb.enabled()) {
+            out << "\nCore,Page_Size_Bytes,L1_TLB_Hits,L1_TLB_Misses,L2_TLB_Hits,L2_TLB_Misses,Walk_References,Walk_Cycles\n";
+            for (int i = 0; i < 4; i++) {
+                const auto& stats = cores[i].cache.stats;
+                out << i << ","
+                    << (1ull << options.tlb.page_bits) << ","
+                    << stats.tlb_l1_hits << ","
+                    << stats.tlb_l1_misses << ","
+                    << stats.tlb_l2_hits << ","
+                    << stats.tlb_l2_misses << ","
+                    << stats.walk_references << ","
+                    << stats.walk_cycles << "\n";
+            }
+        }
+        if (options.snoop_filter) {
+            out << "\nCore,Snoops_Performed,Snoops_Filtered,Filtered_Percent\n";
+            for (int i = 0; i < 4; i++) {
+                uint64_t snoops = snoops_performed[i] + snoops_filtered[i];
+                out << i << ","
+                    << snoops_performed[i] << ","
+                    << snoops_filtered[i] << ","
+                    << std::fixed << std::setprecision(2) << (snoops > 0 ? (double)snoops_filtered[i] / snoops * 100 : 0) << "\n";
+            }
+        }
+        if (options.l2.enabled()) {
+            out << "\nCore,L2_Sets,L2_Ways,L2_Policy,L2_Hits,L2_Misses,L2_Hit_Rate,L2_Evictions,L2_Writebacks,Back_Invalidations\n";
+            for (int i = 0; i < 4; i++) {
+                const auto& l2_stats = cores[i].l2->stats;
+                uint64_t lookups = l2_stats.hit_count + l2_stats.miss_count;
+                out << i << ","
+                    << (1u << options.l2.set_bits) << ","
+                    << options.l2.ways << ","
+                    << inclusion_policy_name(options.l2.policy) << ","
+                    << l2_stats.hit_count << ","
+                    << l2_stats.miss_count << ","
+                    << std::fixed << std::setprecision(2) << (lookups > 0 ? (double)l2_stats.hit_count / lookups * 100 : 0) << ","
+                    << l2_stats.eviction_count << ","
+                    << l2_stats.writeback_count << ","
+                    << cores[i].cache.stats.back_invalidations << "\n";
+            }
+        }
+        if (options.sectors > 1) {
+            out << "\nCore,Sectors,Sector_Size_Bytes,Sector_Misses,Bus_Bytes_Saved\n";
+            for (int i = 0; i < 4; i++) {
+                const auto& stats = cores[i].cache.stats;
+                out << i << "," << options.sectors << "," << transfer_size << ","
+                    << stats.sector_misses << "," << stats.sector_bytes_saved << "\n";
+            }
+        }
+        if (options.numa.enabled()) {
+            out << "\nCore,Socket,Local_Memory_Misses,Remote_Memory_Misses,Remote_Cache_Fills,Cross_Socket_Invalidations\n";
+            for (int i = 0; i < 4; i++) {
+                const auto& stats = cores[i].cache.stats;
+                out << i << "," << socket_of(i) << "," << stats.numa_local_misses << "," << stats.numa_remote_misses << ","
+                    << stats.remote_cache_fills << "," << stats.cross_socket_invalidations << "\n";
+            }
+            out << "\nInter_Socket_Link,Value\n";
+            out << "Sockets," << options.numa.sockets << "\n";
+            out << "Home_Policy," << home_policy_name(options.numa.home) << "\n";
+            out << "Link_Latency," << options.numa.link_latency << "\n";
+            out << "Link_Bytes_Per_Cycle," << options.numa.link_bytes_per_cycle << "\n";
+            out << "Link_Transfers," << link_transfers << "\n";
+            out << "Link_Traffic_Bytes," << link_bytes << "\n";
+            out << "Link_Busy_Cycles," << link_busy_cycles << "\n";
+            out << "Link_Utilization," << std::fixed << std::setprecision(2)
+                << (global_cycle > 0 ? (double)link_busy_cycles / global_cycle * 100 : 0) << "\n";
+        }
+        if (has_atomics()) {
+            out << "\nCore,Atomic_RMW,Load_Reserved,Store_Conditional,SC_Failures,Lock_Cycles,Contention_Cycles\n";
+            for (int i = 0; i < 4; i++) {
+                const auto& stats = cores[i].cache.stats;
+                out << i << "," << stats.atomic_count << "," << stats.lr_count << "," << stats.sc_count << ","
+                    << stats.sc_failures << "," << stats.lock_cycles << "," << stats.contention_cycles << "\n";
+            }
+            out << "\nHot_Block_Address,Contention_Cycles,Failed_SC\n";
+            for (const auto& [block, contention] : hot_blocks(10)) {
+                out << "0x" << std::hex << (block << block_bits) << std::dec << ","
+                    << contention.cycles << "," << contention.failed_sc << "\n";
+            }
+        }
+        if (options.protocol != CoherenceProtocol::MESI) {
+            out << "\nCore,Protocol,Update_Broadcasts,Update_Traffic_Bytes,Updates_Received,Update_Hits\n";
+            for (int i = 0; i < 4; i++) {
+                const auto& stats = cores[i].cache.stats;
+                out << i << "," << protocol_name(options.protocol) << ","
+                    << stats.update_broadcasts << ","
+                    << stats.update_broadcasts * UPDATE_WORD_BYTES << ","
+                    << stats.updates_received << ","
+                    << stats.update_hits << "\n";
+            }
+        }
+        if (options.write_through || !options.write_allocate) {
+            out << "\nCore,Memory_Writes,Memory_Write_Bytes,Combined_Writes,Write_Stall_Cycles\n";
+            for (int i = 0; i < 4; i++) {
+                const auto& stats = cores[i].cache.stats;
+                out << i << "," << stats.memory_writes << "," << stats.memory_write_bytes << ","
+                    << stats.combined_writes << "," << stats.write_stall_cycles << "\n";
+            }
+        }
+        out << "\nOverall_Bus_Summary,Value\n";
+        out << "Total_Bus_Transactions," << total_bus_transactions << "\n";
+        out << "Total_Bus_Traffic_Bytes," << total_bus_traffic << "\n";
+        out << "Max_Execution_Time," << get_max_execution_time() << "\n"; // Added Max_Execution_Time
+    } else {
+        out << "Simulation Parameters:\n";
+        out << "Trace Prefix: " << trace_prefix << "\n";
+        out << "Set Index Bits: " << set_index_bits << "\n";
+        out << "Associativity: " << associativity << "\n";
+        out << "Block Bits: " << block_bits << "\n";
+        out << "Block Size (Bytes): " << block_size << "\n";
+        out << "Number of Sets: " << num_sets << "\n";
+        out << "Cache Size (KB per core): " << std::fixed << std::setprecision(2) << cache_size_kb << "\n";
+        if (options.protocol == CoherenceProtocol::MESI) out << "MESI Protocol: Enabled\n";
+        else out << "Coherence Protocol: " << protocol_name(options.protocol) << " (write update)\n";
+        out << "Write Policy: " << write_policy_name(options, ", ") << "\n";
+        out << "Replacement Policy: LRU\n";
+        if (options.index_mode != IndexMode::MODULO) out << "Index Function: " << index_mode_name(options.index_mode) << "\n";
+        out << "Bus: Central snooping bus\n";
+        for (int i = 0; i < 4; i++) {
+            const auto& stats = cores[i].cache.stats;
+            uint64_t total_instructions = stats.read_count + stats.write_count;
+            double miss_rate = (stats.hit_count + stats.miss_count) > 0 ?
+                (double)stats.miss_count / (stats.hit_count + stats.miss_count) * 100 : 0;
+            out << "\nCore " << i << " Statistics:\n";
+            out << "Total Instructions: " << total_instructions << "\n";
+            out << "Total Reads: " << stats.read_count << "\n";
+            out << "Total Writes: " << stats.write_count << "\n";
+            out << "Total Execution Cycles: " << stats.total_cycles << "\n";
+            out << "Idle Cycles: " << stats.idle_cycles << "\n";
+            out << "Cache Misses: " << stats.miss_count << "\n";
+            out << "Cache Miss Rate: " << std::fixed << std::setprecision(2) << miss_rate << "%\n";
+            out << "Cache Evictions: " << stats.eviction_count << "\n";
+            out << "Writebacks: " << stats.writeback_count << "\n";
+            out << "Bus Invalidations: " << stats.invalidations << "\n";
+            out << "Data Traffic (Bytes): " << stats.data_traffic << "\n";
+            if (options.classify_misses) {
+                out << "Compulsory Misses: " << stats.compulsory_misses << "\n";
+                out << "Capacity Misses: " << stats.capacity_misses << "\n";
+                out << "Conflict Misses: " << stats.conflict_misses << "\n";
+                out << "Coherence Misses: " << stats.coherence_misses << "\n";
+            }
+            if (options.victim_entries > 0) {
+                uint64_t probes = stats.victim_hits + stats.miss_count;
+                double hit_rate = probes > 0 ? (double)stats.victim_hits / probes * 100 : 0;
+                out << "Victim Cache Hits: " << stats.victim_hits << " of " << probes << " probes ("
+                    << std::fixed << std::setprecision(2) << hit_rate << "%)\n";
+                out << "Victim Cache Cycles Saved: " << stats.victim_cycles_saved << "\n";
+            }
+            if (options.tlb.enabled()) {
+                out << "L1 TLB Hits: " << stats.tlb_l1_hits << " of " << stats.tlb_l1_hits + stats.tlb_l1_misses << "\n";
+                out << "L2 TLB Hits: " << stats.tlb_l2_hits << " of " << stats.tlb_l1_misses << "\n";
+                out << "Page Walks: " << stats.tlb_l2_misses << " (" << stats.walk_references << " references, "
+                    << stats.walk_cycles << " cycles)\n";
+            }
+            if (options.l2.enabled()) {
+                const auto& l2_stats = cores[i].l2->stats;
+                out << "L2 Hits: " << l2_stats.hit_count << " of " << l2_stats.hit_count + l2_stats.miss_count << "\n";
+                out << "L2 Evictions: " << l2_stats.eviction_count << "\n";
+                out << "L2 Writebacks: " << l2_stats.writeback_count << "\n";
+                out << "Back Invalidations: " << stats.back_invalidations << "\n";
+            }
+            if (options.snoop_filter) {
+                out << "Snoops Performed: " << snoops_performed[i] << "\n";
+                out << "Snoops Filtered: " << snoops_filtered[i] << "\n";
+            }
+            if (options.sectors > 1) {
+                out << "Sector Misses: " << stats.sector_misses << "\n";
+                out << "Bus Bytes Saved by Sectors: " << stats.sector_bytes_saved << "\n";
+            }
+            if (options.protocol != CoherenceProtocol::MESI) {
+                out << "Update Broadcasts: " << stats.update_broadcasts << " ("
+                    << stats.update_broadcasts * UPDATE_WORD_BYTES << " bytes)\n";
+                out << "Updates Received: " << stats.updates_received << "\n";
+                out << "Hits on Updated Lines: " << stats.update_hits << "\n";
+            }
+            if (options.numa.enabled()) {
+                out << "Socket: " << socket_of(i) << "\n";
+                out << "Local Memory Misses: " << stats.numa_local_misses << "\n";
+                out << "Remote Memory Misses: " << stats.numa_remote_misses << "\n";
+                out << "Remote Cache Fills: " << stats.remote_cache_fills << "\n";
+                out << "Cross Socket Invalidations: " << stats.cross_socket_invalidations << "\n";
+            }
+            if (options.write_through || !options.write_allocate) {
+                out << "Memory Writes: " << stats.memory_writes << " (" << stats.memory_write_bytes << " bytes)\n";
+                if (options.combining_entries > 0) out << "Combined Writes: " << stats.combined_writes << "\n";
+                out << "Write Stall Cycles: " << stats.write_stall_cycles << "\n";
+            }
+            if (has_atomics()) {
+                out << "Atomics: " << stats.atomic_count << " RMW, " << stats.lr_count << " LR, " << stats.sc_count
+                    << " SC (" << stats.sc_failures << " failed)\n";
+                out << "Lock Cycles: " << stats.lock_cycles << "\n";
+                out << "Contention Cycles: " << stats.contention_cycles << "\n";
+            }
+        }
+        if (options.numa.enabled()) {
+            out << "\nInter Socket Link (" << options.numa.sockets << " sockets, " << home_policy_name(options.numa.home)
+                << " homing):\n";
+            out << "Link Transfers: " << link_transfers << "\n";
+            out << "Link Traffic (Bytes): " << link_bytes << "\n";
+            out << "Link Busy Cycles: " << link_busy_cycles << "\n";
+        }
+        if (has_atomics()) {
+            out << "\nHot Blocks (contention cycles, failed SC):\n";
+            for (const auto& [block, contention] : hot_blocks(10)) {
+                out << "0x" << std::hex << (block << block_bits) << std::dec << ": " << contention.cycles << ", "
+                    << contention.failed_sc << "\n";
+            }
+        }
+        out << "\nOverall Bus Summary:\n";
+        out << "Total Bus Transactions: " << total_bus_transactions << "\n";
+        out << "Total Bus Traffic (Bytes): " << total_bus_traffic << "\n";
+        out << "Maximum Execution Time: " << get_max_execution_time() << "\n"; // Added Max_Execution_Time
+    }
+}
+};
+
+// this is the result of a lockstep run , cycle is the first cycle after which the engines were seen to differ and
+// access is how many accesses the core had finished by then
+struct Divergence {
+    bool found = false;
+    uint64_t cycle = 0;
+    int core = -1;
+    uint64_t access = 0;
+    std::string what;
+};
+
+
+// the options for the reference side of a lockstep run , it writes none of the extra output files
+inline SimOptions reference_options(SimOptions options) {
+    // the reference snoops every core , so --verify also checks that the presence filter never skips a holder
+    options.snoop_filter = false;
+    options.profile = false;
+    options.set_heatmap_file.clear();
+    options.interval_cycles = 0;
+    options.timeseries_file.clear();
+    return options;
+}
+
+
+// runs a reference and an optimized engine side by side on the same accesses , both have to be loaded already
+// the stats , queues and bus are compared after every cycle and the contents of the caches every checkpoint cycles
+// (and at the end) , so with checkpoint 1 the first differing cycle is exact for everything
+// with checkpoint 0 everything is only compared at the end , for an engine that takes a different path to the same result
+template <class RefSim, class FastSim>
+Divergence run_lockstep(RefSim& ref, FastSim& fast, uint64_t checkpoint) {
+    Divergence result;
+    auto differ = [&](int core, const std::string& what) {
+        result.found = true;
+        result.cycle = ref.global_cycle;
+        result.core = core;
+        if (core >= 0) {
+            const CoreStats& stats = ref.cores[core].cache.stats;
+            result.access = stats.read_count + stats.write_count - ref.cores[core].instructions.size();
+        }
+        result.what = what;
+    };
+
+    auto compare_cores = [&]() {
+        for (size_t i = 0; i < ref.cores.size(); i++) {
+            const auto& a = ref.cores[i];
+            const auto& b = fast.cores[i];
+            for (const auto& field : CORE_STAT_FIELDS) {
+                if (a.cache.stats.*field.second != b.cache.stats.*field.second) {
+                    differ(i, std::string(field.first) + " " + std::to_string(a.cache.stats.*field.second) +
+                              " vs " + std::to_string(b.cache.stats.*field.second));
+                    return;
+                }
+            }
+            if (a.instructions.size() != b.instructions.size()) return differ(i, "pending accesses");
+            if (a.stall_cycles != b.stall_cycles) return differ(i, "stall cycles");
+            if (a.waiting_for_bus != b.waiting_for_bus) return differ(i, "waiting for bus");
+        }
+        if (ref.bus_busy_cycles != fast.bus_busy_cycles) return differ(-1, "bus busy cycles");
+        if (ref.bus_queue.size() != fast.bus_queue.size()) return differ(-1, "bus queue depth");
+        for (int s = 1; s < 4; s++) {
+            if (ref.socket_buses[s].busy_cycles != fast.socket_buses[s].busy_cycles ||
+                ref.socket_buses[s].queue.size() != fast.socket_buses[s].queue.size()) {
+                return differ(-1, "bus of socket " + std::to_string(s));
+            }
+        }
+        if (ref.link_bytes != fast.link_bytes) return differ(-1, "link traffic");
+        if (ref.total_bus_transactions != fast.total_bus_transactions) return differ(-1, "bus transactions");
+        if (ref.total_bus_traffic != fast.total_bus_traffic) return differ(-1, "bus traffic");
+    };
+
+    auto compare_caches = [&]() {
+        for (size_t i = 0; i < ref.cores.size() && !result.found; i++) {
+            const auto& a = ref.cores[i].cache;
+            const auto& b = fast.cores[i].cache;
+            for (size_t l = 0; l < a.cache_lines.size(); l++) {
+                const CacheLine& x = a.cache_lines[l];
+                const CacheLine& y = b.cache_lines[l];
+                if (x.valid != y.valid ||
+                    (x.valid && (a.full_tag(x) != b.full_tag(y) || x.state != y.state || x.dirty != y.dirty ||
+                                 x.lru_counter != y.lru_counter))) {
+                    return differ(i, "line " + std::to_string(l % a.associativity) + " of set " +
+                                     std::to_string(l / a.associativity));
+                }
+            }
+            for (size_t v = 0; v < a.victim_lines.size(); v++) {
+                const VictimLine& x = a.victim_lines[v];
+                const VictimLine& y = b.victim_lines[v];
+                if (x.line.valid != y.line.valid ||
+                    (x.line.valid && (x.block != y.block || x.line.state != y.line.state || x.line.dirty != y.line.dirty))) {
+                    return differ(i, "victim cache entry " + std::to_string(v));
+                }
+            }
+            for (size_t k = 0; k < a.sector_states.size(); k++) {
+                const SectorState& x = a.sector_states[k];
+                const SectorState& y = b.sector_states[k];
+                if (x.state != y.state || (x.state != MESIState::INVALID && x.dirty != y.dirty)) {
+                    return differ(i, "sector " + std::to_string(k % a.sector_count) + " of line " +
+                                     std::to_string(k / a.sector_count));
+                }
+            }
+        }
+    };
+
+    while (true) {
+        bool ref_running = ref.step();
+        bool fast_running = fast.step();
+        if (ref_running != fast_running) {
+            differ(-1, ref_running ? "optimized engine finished early" : "reference engine finished early");
+            break;
+        }
+        if (checkpoint > 0 || !ref_running) compare_cores();
+        if (!result.found && (!ref_running || (checkpoint > 0 && ref.global_cycle % checkpoint == 0))) compare_caches();
+        if (result.found || !ref_running) break;
+    }
+    return result;
+}
+
+
+// the representative intervals the simpoint tool picked for an application , every one stands for cluster_size
+// intervals of interval_length accesses per core , interval i covers accesses i * interval_length onwards of every core
+struct SimPoint {
+    uint64_t interval;
+    uint64_t cluster_size;
+};
+
+struct SimPointSet {
+    uint64_t interval_length = 0;
+    uint64_t intervals = 0;
+    std::vector<SimPoint> points;
+};
+
+// # simpoints <interval length> <intervals> then <interval> <cluster size> <weight> for every representative ,
+// the weight is the share of all intervals its cluster has
+inline bool write_simpoints(const std::string& filename, const SimPointSet& set) {
+    std::ofstream out(filename);
+    if (!out) return false;
+    out << "# simpoints " << set.interval_length << " " << set.intervals << "\n";
+    for (const auto& point : set.points) {
+        out << point.interval << " " << point.cluster_size << " " << std::fixed << std::setprecision(6)
+            << (double)point.cluster_size / set.intervals << "\n";
+    }
+    return true;
+}
+
+inline bool read_simpoints(const std::string& filename, SimPointSet& set) {
+    std::ifstream in(filename);
+    std::string hash, word;
+    if (!(in >> hash >> word >> set.interval_length >> set.intervals) || hash != "#" || word != "simpoints" ||
+        set.interval_length == 0) {
+        return false;
+    }
+    SimPoint point;
+    double weight;
+    uint64_t covered = 0;
+    while (in >> point.interval >> point.cluster_size >> weight) {
+        if (point.interval >= set.intervals) return false;
+        set.points.push_back(point);
+        covered += point.cluster_size;
+    }
+    return !set.points.empty() && covered == set.intervals;
+}
+
+
+// libcachesim.a has the generic engine compiled already , define CACHESIM_PREBUILT when linking against it
+// so it is not compiled again in every file that includes this header
+#ifdef CACHESIM_PREBUILT
+extern template class Simulator<Cache<>>;
+#endif
+
+#endif
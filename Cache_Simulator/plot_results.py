@@ -2,11 +2,23 @@ import pandas as pd
 import matplotlib.pyplot as plt
 import numpy as np
 import os
+import io
 
 # Create output and plots directories
 os.makedirs('output', exist_ok=True)
 os.makedirs('plots', exist_ok=True)
 
+# The simulator only writes its optional tables when they are switched on, so the tables are
+# found by their header line instead of a fixed line offset
+def read_section(path, header_prefix):
+    with open(path) as f:
+        lines = f.read().splitlines()
+    start = next(i for i, line in enumerate(lines) if line.startswith(header_prefix))
+    end = start
+    while end < len(lines) and lines[end].strip():
+        end += 1
+    return pd.read_csv(io.StringIO('\n'.join(lines[start:end])))
+
 # 1. Distribution plots for 10 runs
 runs = range(1, 11)
 # miss_rates = []
@@ -35,7 +47,7 @@ core_columns = [
 for run in runs:
     try:
         # Read core statistics section (skip parameter section, read 4 rows for 4 cores)
-        df_core = pd.read_csv(f'output/output_run{run}.csv', skiprows=12, nrows=4, names=core_columns, header=0)
+        df_core = read_section(f'output/output_run{run}.csv', 'Core,Total_Instructions')[core_columns]
         print(f"Run {run} core data:\n{df_core}\n")
         if len(df_core) != 4:
             raise ValueError(f"Expected 4 rows for core stats in output_run{run}.csv, got {len(df_core)}")
@@ -70,7 +82,7 @@ cache_sizes = [4, 8, 16, 32]  # KB
 max_times_s = []
 for s in [6, 7, 8, 9]:
     try:
-        df = pd.read_csv(f'output/output_s{s}.csv', skiprows=18, header=0)
+        df = read_section(f'output/output_s{s}.csv', 'Overall_Bus_Summary')
         max_time = float(df[df['Overall_Bus_Summary'] == 'Max_Execution_Time']['Value'].iloc[0])
         max_times_s.append(max_time)
         print(f"Cache size s={s}: Max_Execution_Time={max_time}")
@@ -90,7 +102,7 @@ assoc = [1, 2, 4, 8]
 max_times_E = []
 for E in [1, 2, 4, 8]:
     try:
-        df = pd.read_csv(f'output/output_E{E}.csv', skiprows=18, header=0)
+        df = read_section(f'output/output_E{E}.csv', 'Overall_Bus_Summary')
         max_time = float(df[df['Overall_Bus_Summary'] == 'Max_Execution_Time']['Value'].iloc[0])
         max_times_E.append(max_time)
         print(f"Associativity E={E}: Max_Execution_Time={max_time}")
@@ -109,7 +121,7 @@ block_sizes = [16, 32, 64, 128]  # Bytes
 max_times_b = []
 for b in [4, 5, 6, 7]:
     try:
-        df = pd.read_csv(f'output/output_b{b}.csv', skiprows=18, header=0)
+        df = read_section(f'output/output_b{b}.csv', 'Overall_Bus_Summary')
         max_time = float(df[df['Overall_Bus_Summary'] == 'Max_Execution_Time']['Value'].iloc[0])
         max_times_b.append(max_time)
         print(f"Block size b={b}: Max_Execution_Time={max_time}")
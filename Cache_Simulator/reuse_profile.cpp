@@ -0,0 +1,330 @@
+#include "cachesim.hpp"
+#include <getopt.h>
+#include <sstream>
+
+// this profiles how the four traces of an application reuse their blocks , before any cache is simulated
+// - the working set , the distinct blocks a core touches in a window of W of its accesses , for several W
+// - the reuse time , how many accesses of a core go by between two accesses to the same block
+// - the footprint of every core and how much of it is private , touched by no other core
+// the traces are streamed side by side and the memory does not grow with them : distinct blocks are counted with
+// HyperLogLog sketches and reuse times are taken on a hash sample of the blocks
+
+// 2^12 one byte registers per window sketch , a standard error of about 1.6%
+const uint32_t HLL_BITS = 12;
+// the private footprints are differences of whole footprints , so those sketches get 2^16 registers and about 0.4%
+const uint32_t FOOTPRINT_HLL_BITS = 16;
+// reuse times are put in powers of two , bucket i holds [2^i, 2^(i+1))
+const int REUSE_BUCKETS = 48;
+
+// the blocks are hashed once , every sketch and the sampler work on this hash
+inline uint64_t hash_block(uint64_t block) {
+    block += 0x9E3779B97F4A7C15ull;
+    block = (block ^ (block >> 30)) * 0xBF58476D1CE4E5B9ull;
+    block = (block ^ (block >> 27)) * 0x94D049BB133111EBull;
+    return block ^ (block >> 31);
+}
+
+class HyperLogLog {
+public:
+    uint32_t bits;
+    std::vector<uint8_t> registers;
+
+    explicit HyperLogLog(uint32_t bits = HLL_BITS) : bits(bits), registers(1u << bits, 0) {}
+
+    // the top bits pick the register , which keeps the longest run of leading zeros seen in the rest
+    void add(uint64_t hash) {
+        uint32_t index = static_cast<uint32_t>(hash >> (64 - bits));
+        uint64_t rest = hash << bits;
+        uint8_t rank = rest == 0 ? 64 - bits + 1 : __builtin_clzll(rest) + 1;
+        registers[index] = std::max(registers[index], rank);
+    }
+
+    // the sketch of the union of both sets , they must have the same number of registers
+    void merge(const HyperLogLog& other) {
+        for (size_t i = 0; i < registers.size(); i++) registers[i] = std::max(registers[i], other.registers[i]);
+    }
+
+    void clear() { std::fill(registers.begin(), registers.end(), 0); }
+
+    double estimate() const {
+        double m = registers.size();
+        double sum = 0;
+        uint32_t zeros = 0;
+        for (uint8_t rank : registers) {
+            sum += std::ldexp(1.0, -rank);
+            zeros += rank == 0;
+        }
+        double e = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+        // small sets are counted better from the registers that are still empty
+        if (e <= 2.5 * m && zeros > 0) e = m * std::log(m / zeros);
+        return e;
+    }
+};
+
+// reuse times of one core on the blocks whose hash is at most threshold , when more than capacity blocks are tracked
+// the threshold drops below the largest hash so the memory stays fixed , and every sampled reuse stands for
+// 2^64 / (threshold + 1) reuses of the whole trace
+class ReuseSampler {
+public:
+    size_t capacity;
+    uint64_t threshold = ~0ull;
+    // the time of the last access of every sampled block , by its hash so the largest one is quick to drop
+    std::map<uint64_t, uint64_t> last_access;
+    std::vector<double> buckets = std::vector<double>(REUSE_BUCKETS, 0.0);
+
+    explicit ReuseSampler(size_t capacity) : capacity(capacity) {}
+
+    double rate() const { return std::ldexp(static_cast<double>(threshold) + 1.0, -64); }
+
+    void access(uint64_t hash, uint64_t time) {
+        if (hash > threshold) return;
+        auto [it, added] = last_access.emplace(hash, time);
+        if (!added) {
+            uint64_t reuse = time - it->second;
+            buckets[std::min(63 - __builtin_clzll(reuse), REUSE_BUCKETS - 1)] += 1.0 / rate();
+            it->second = time;
+        } else if (last_access.size() > capacity) {
+            auto largest = std::prev(last_access.end());
+            threshold = largest->first - 1;
+            last_access.erase(largest);
+        }
+    }
+};
+
+// the working set of one core , or of all of them , at one window length
+struct WindowSeries {
+    HyperLogLog current;
+    uint64_t windows = 0;
+    double sum = 0;
+    double largest = 0;
+
+    void finish(double blocks) {
+        windows++;
+        sum += blocks;
+        largest = std::max(largest, blocks);
+    }
+
+    double average() const { return windows > 0 ? sum / windows : 0; }
+};
+
+struct CoreProfile {
+    std::ifstream trace;
+    bool active = true;
+    uint64_t accesses = 0;
+    HyperLogLog footprint;
+    std::vector<WindowSeries> series;
+    ReuseSampler reuse;
+
+    CoreProfile(size_t windows, size_t sample_blocks) : footprint(FOOTPRINT_HLL_BITS), series(windows), reuse(sample_blocks) {}
+};
+
+bool parse_windows(const std::string& text, std::vector<uint64_t>& windows) {
+    std::stringstream list(text);
+    std::string item;
+    while (std::getline(list, item, ',')) {
+        try {
+            windows.push_back(std::stoull(item));
+        } catch (...) {
+            return false;
+        }
+        if (windows.back() == 0) return false;
+    }
+    return !windows.empty();
+}
+
+int main(int argc, char* argv[]) {
+    std::string trace_prefix;
+    std::string outfilename;
+    uint32_t b = 6;
+    uint32_t paddr_bits = 48;
+    size_t sample_blocks = 8192;
+    std::vector<uint64_t> window_lengths;
+
+    enum { OPT_SAMPLE_BLOCKS = 256, OPT_PADDR_BITS };
+    static const struct option long_options[] = {
+        {"sample-blocks", required_argument, nullptr, OPT_SAMPLE_BLOCKS},
+        {"paddr-bits", required_argument, nullptr, OPT_PADDR_BITS},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "ht:b:w:o:", long_options, nullptr)) != -1) {
+        try {
+            switch (opt) {
+                case 't': trace_prefix = optarg; break;
+                case 'b': b = std::stoul(optarg); break;
+                case 'o': outfilename = optarg; break;
+                case 'w':
+                    if (!parse_windows(optarg, window_lengths)) throw std::invalid_argument("windows");
+                    break;
+                case OPT_SAMPLE_BLOCKS: sample_blocks = std::stoull(optarg); break;
+                case OPT_PADDR_BITS: paddr_bits = std::stoul(optarg); break;
+                default:
+                    std::cout << "Usage: " << argv[0] << " -t <trace_prefix> [-b <block_bits>] [-w <window>,<window>,...] [-o <csv file>]\n"
+                              << "       [--sample-blocks <N>] [--paddr-bits <P>]\n"
+                              << "estimates the working sets , reuse times and shared footprint of the four traces\n";
+                    return opt == 'h' ? 0 : 1;
+            }
+        } catch (...) {
+            std::cerr << "Error: Invalid value for option " << static_cast<char>(opt) << "\n";
+            return 1;
+        }
+    }
+
+    if (trace_prefix.empty()) {
+        std::cerr << "Error: Missing required arguments\n";
+        return 1;
+    }
+    if (b == 0 || b >= 32 || paddr_bits > 64 || paddr_bits <= b || sample_blocks == 0) {
+        std::cerr << "Error: -b must be from 1 to 31 , --paddr-bits more than b and at most 64 and --sample-blocks positive\n";
+        return 1;
+    }
+    if (window_lengths.empty()) window_lengths = {1000, 10000, 100000, 1000000};
+    std::sort(window_lengths.begin(), window_lengths.end());
+    window_lengths.erase(std::unique(window_lengths.begin(), window_lengths.end()), window_lengths.end());
+
+    std::vector<CoreProfile> cores;
+    for (int i = 0; i < 4; i++) {
+        cores.emplace_back(window_lengths.size(), sample_blocks);
+        std::string filename = trace_prefix + "_proc" + std::to_string(i) + ".trace";
+        cores[i].trace.open(filename);
+        if (!cores[i].trace) {
+            std::cerr << "Error: Trace file " << filename << " does not exist or cannot be opened\n";
+            return 1;
+        }
+    }
+
+    // the k-th access of every core is read at time k , the windows of all cores end together and the working set of
+    // all cores is the union of the windows that ended , a core whose trace ran out drops its last partial window
+    std::vector<WindowSeries> all_cores(window_lengths.size());
+    HyperLogLog merged;
+    uint64_t mask = paddr_mask(paddr_bits);
+    for (uint64_t time = 1;; time++) {
+        bool any = false;
+        for (auto& core : cores) {
+            Access access;
+            if (!core.active) continue;
+            if (!read_trace_access(core.trace, mask, access)) {
+                core.active = false;
+                continue;
+            }
+            any = true;
+            core.accesses++;
+            uint64_t hash = hash_block(access.address >> b);
+            core.footprint.add(hash);
+            for (auto& series : core.series) series.current.add(hash);
+            core.reuse.access(hash, time);
+        }
+        if (!any) break;
+        for (size_t w = 0; w < window_lengths.size(); w++) {
+            if (time % window_lengths[w] != 0) continue;
+            merged.clear();
+            for (auto& core : cores) {
+                if (!core.active) continue;
+                WindowSeries& series = core.series[w];
+                series.finish(series.current.estimate());
+                merged.merge(series.current);
+                series.current.clear();
+            }
+            all_cores[w].finish(merged.estimate());
+        }
+    }
+
+    // a block is private to a core if the union of all footprints loses it without that core's
+    HyperLogLog everything(FOOTPRINT_HLL_BITS);
+    for (const auto& core : cores) everything.merge(core.footprint);
+    double total_blocks = everything.estimate();
+    double private_blocks[4];
+    double all_private = 0;
+    for (int i = 0; i < 4; i++) {
+        HyperLogLog others(FOOTPRINT_HLL_BITS);
+        for (int j = 0; j < 4; j++) {
+            if (j != i) others.merge(cores[j].footprint);
+        }
+        private_blocks[i] = std::max(0.0, total_blocks - others.estimate());
+        all_private += private_blocks[i];
+    }
+    all_private = std::min(all_private, total_blocks);
+    double shared_blocks = total_blocks - all_private;
+    double block_kb = (1u << b) / 1024.0;
+    uint64_t total_accesses = 0;
+    for (const auto& core : cores) total_accesses += core.accesses;
+
+    std::cout << std::fixed << std::setprecision(0);
+    std::cout << "Reuse profile of " << trace_prefix << " (" << (1u << b) << " byte blocks, estimates):\n";
+    std::cout << "\nFootprint:\n";
+    for (int i = 0; i < 4; i++) {
+        std::cout << "Core " << i << ": " << cores[i].accesses << " accesses, " << cores[i].footprint.estimate()
+                  << " blocks, " << private_blocks[i] << " private\n";
+    }
+    std::cout << "All cores: " << total_blocks << " blocks (" << std::setprecision(1) << total_blocks * block_kb
+              << " KB), " << std::setprecision(0) << shared_blocks << " shared by two or more cores ("
+              << std::setprecision(1) << (total_blocks > 0 ? shared_blocks / total_blocks * 100 : 0) << "%)\n";
+
+    std::cout << "\nWorking set (average and largest blocks in a window of accesses per core):\n";
+    for (size_t w = 0; w < window_lengths.size(); w++) {
+        std::cout << "Window " << window_lengths[w] << ":";
+        for (int i = 0; i < 4; i++) {
+            std::cout << std::setprecision(0) << " core " << i << " " << cores[i].series[w].average() << "/"
+                      << cores[i].series[w].largest << ",";
+        }
+        std::cout << " all " << all_cores[w].average() << "/" << all_cores[w].largest << " ("
+                  << std::setprecision(1) << all_cores[w].average() * block_kb << " KB average)";
+        if (all_cores[w].windows == 0) std::cout << " , longer than the traces";
+        std::cout << "\n";
+    }
+
+    std::cout << "\nReuse time (accesses of the core since the last access to the block):\n";
+    for (int i = 0; i < 4; i++) {
+        const ReuseSampler& reuse = cores[i].reuse;
+        std::cout << "Core " << i << " (" << std::setprecision(4) << reuse.rate() * 100 << "% of blocks sampled):";
+        for (int k = 0; k < REUSE_BUCKETS; k++) {
+            if (reuse.buckets[k] > 0) std::cout << std::setprecision(0) << " <" << (2ull << k) << ":" << reuse.buckets[k];
+        }
+        std::cout << "\n";
+    }
+
+    if (!outfilename.empty()) {
+        std::ofstream out(outfilename);
+        if (!out) {
+            std::cerr << "Error: Cannot open output file " << outfilename << "\n";
+            return 1;
+        }
+        out << std::fixed << std::setprecision(0);
+        out << "Parameter,Value\n";
+        out << "Trace_Prefix," << trace_prefix << "\n";
+        out << "Block_Bits," << b << "\n";
+        out << "Window_Sketch_Registers," << (1u << HLL_BITS) << "\n";
+        out << "Footprint_Sketch_Registers," << (1u << FOOTPRINT_HLL_BITS) << "\n";
+        out << "Sample_Blocks," << sample_blocks << "\n";
+        out << "\nCore,Accesses,Footprint_Blocks,Private_Blocks,Reuse_Sample_Rate\n";
+        for (int i = 0; i < 4; i++) {
+            out << i << "," << cores[i].accesses << "," << cores[i].footprint.estimate() << "," << private_blocks[i] << ","
+                << std::setprecision(6) << cores[i].reuse.rate() << std::setprecision(0) << "\n";
+        }
+        out << "All," << total_accesses << "," << total_blocks << "," << all_private << ",\n";
+        out << "\nShared_Footprint,Value\n";
+        out << "Total_Blocks," << total_blocks << "\n";
+        out << "Private_Blocks," << all_private << "\n";
+        out << "Shared_Blocks," << shared_blocks << "\n";
+        out << "Shared_Percent," << std::setprecision(2) << (total_blocks > 0 ? shared_blocks / total_blocks * 100 : 0)
+            << std::setprecision(0) << "\n";
+        out << "\nWindow_Accesses,Core,Windows,Avg_Working_Set_Blocks,Max_Working_Set_Blocks,Avg_Working_Set_KB\n";
+        for (size_t w = 0; w < window_lengths.size(); w++) {
+            for (int i = 0; i <= 4; i++) {
+                const WindowSeries& series = i < 4 ? cores[i].series[w] : all_cores[w];
+                out << window_lengths[w] << "," << (i < 4 ? std::to_string(i) : "All") << "," << series.windows << ","
+                    << series.average() << "," << series.largest << ","
+                    << std::setprecision(2) << series.average() * block_kb << std::setprecision(0) << "\n";
+            }
+        }
+        out << "\nCore,Reuse_Time_From,Reuse_Time_To,Estimated_Reuses\n";
+        for (int i = 0; i < 4; i++) {
+            for (int k = 0; k < REUSE_BUCKETS; k++) {
+                if (cores[i].reuse.buckets[k] == 0) continue;
+                out << i << "," << (1ull << k) << "," << (2ull << k) - 1 << "," << cores[i].reuse.buckets[k] << "\n";
+            }
+        }
+    }
+    return 0;
+}
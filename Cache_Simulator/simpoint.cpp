@@ -0,0 +1,206 @@
+#include "cachesim.hpp"
+#include <getopt.h>
+#include <limits>
+#include <random>
+
+// this picks the representative intervals of an application for L1simulate --simpoints
+// the four traces are cut into intervals of the same number of accesses per core , every interval gets a signature of
+// which address regions it touched , the signatures are clustered with k-means and the interval closest to the centre
+// of every cluster stands for all the intervals of its cluster
+
+// regions are hashed into this many buckets , which keeps every signature small whatever the footprint
+const int SIGNATURE_DIMS = 256;
+
+using Signature = std::vector<double>;
+
+// the share of the interval's accesses that went to every bucket of regions
+std::vector<Signature> build_signatures(const std::vector<Access> (&traces)[4], uint64_t interval_length,
+                                        uint64_t intervals, uint32_t region_bits) {
+    std::vector<Signature> signatures(intervals, Signature(SIGNATURE_DIMS, 0.0));
+    for (uint64_t i = 0; i < intervals; i++) {
+        uint64_t total = 0;
+        for (const auto& trace : traces) {
+            uint64_t first = std::min<uint64_t>(i * interval_length, trace.size());
+            uint64_t last = std::min<uint64_t>(first + interval_length, trace.size());
+            for (uint64_t k = first; k < last; k++) {
+                uint64_t h = (trace[k].address >> region_bits) * 0x9E3779B97F4A7C15ull;
+                signatures[i][(h >> 32) % SIGNATURE_DIMS] += 1;
+            }
+            total += last - first;
+        }
+        if (total > 0) {
+            for (double& value : signatures[i]) value /= total;
+        }
+    }
+    return signatures;
+}
+
+double distance2(const Signature& a, const Signature& b) {
+    double sum = 0;
+    for (int d = 0; d < SIGNATURE_DIMS; d++) sum += (a[d] - b[d]) * (a[d] - b[d]);
+    return sum;
+}
+
+struct Clustering {
+    std::vector<uint32_t> assignment;
+    std::vector<Signature> centres;
+    double error = 0;
+};
+
+// k-means++ seeding then Lloyd iterations , with a fixed seed so the same traces always give the same intervals
+Clustering kmeans(const std::vector<Signature>& signatures, uint32_t k) {
+    std::mt19937_64 random(1);
+    Clustering result;
+    std::vector<double> nearest(signatures.size(), std::numeric_limits<double>::max());
+    result.centres.push_back(signatures[random() % signatures.size()]);
+    while (result.centres.size() < k) {
+        double sum = 0;
+        for (size_t i = 0; i < signatures.size(); i++) {
+            nearest[i] = std::min(nearest[i], distance2(signatures[i], result.centres.back()));
+            sum += nearest[i];
+        }
+        if (sum == 0) break;
+        double pick = std::uniform_real_distribution<double>(0, sum)(random);
+        size_t chosen = 0;
+        while (chosen + 1 < signatures.size() && pick >= nearest[chosen]) pick -= nearest[chosen++];
+        result.centres.push_back(signatures[chosen]);
+    }
+
+    result.assignment.assign(signatures.size(), 0);
+    for (int iteration = 0; iteration < 100; iteration++) {
+        bool moved = false;
+        result.error = 0;
+        for (size_t i = 0; i < signatures.size(); i++) {
+            uint32_t best = 0;
+            double best_distance = std::numeric_limits<double>::max();
+            for (uint32_t c = 0; c < result.centres.size(); c++) {
+                double d = distance2(signatures[i], result.centres[c]);
+                if (d < best_distance) {
+                    best_distance = d;
+                    best = c;
+                }
+            }
+            moved = moved || result.assignment[i] != best;
+            result.assignment[i] = best;
+            result.error += best_distance;
+        }
+        if (!moved && iteration > 0) break;
+        std::vector<Signature> sums(result.centres.size(), Signature(SIGNATURE_DIMS, 0.0));
+        std::vector<uint64_t> counts(result.centres.size(), 0);
+        for (size_t i = 0; i < signatures.size(); i++) {
+            counts[result.assignment[i]]++;
+            for (int d = 0; d < SIGNATURE_DIMS; d++) sums[result.assignment[i]][d] += signatures[i][d];
+        }
+        for (size_t c = 0; c < result.centres.size(); c++) {
+            if (counts[c] == 0) continue;
+            for (int d = 0; d < SIGNATURE_DIMS; d++) result.centres[c][d] = sums[c][d] / counts[c];
+        }
+    }
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    std::string trace_prefix;
+    uint64_t interval_length = 100000;
+    uint32_t max_clusters = 10;
+    uint32_t region_bits = 12;
+    uint32_t paddr_bits = 48;
+
+    enum { OPT_REGION_BITS = 256, OPT_PADDR_BITS };
+    static const struct option long_options[] = {
+        {"region-bits", required_argument, nullptr, OPT_REGION_BITS},
+        {"paddr-bits", required_argument, nullptr, OPT_PADDR_BITS},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "ht:n:k:", long_options, nullptr)) != -1) {
+        try {
+            switch (opt) {
+                case 't': trace_prefix = optarg; break;
+                case 'n': interval_length = std::stoull(optarg); break;
+                case 'k': max_clusters = std::stoul(optarg); break;
+                case OPT_REGION_BITS: region_bits = std::stoul(optarg); break;
+                case OPT_PADDR_BITS: paddr_bits = std::stoul(optarg); break;
+                default:
+                    std::cout << "Usage: " << argv[0] << " -t <trace_prefix> [-n <interval accesses per core>] [-k <max clusters>]\n"
+                              << "       [--region-bits <R>] [--paddr-bits <P>]\n"
+                              << "writes <trace_prefix>.simpoints for L1simulate --simpoints\n";
+                    return opt == 'h' ? 0 : 1;
+            }
+        } catch (...) {
+            std::cerr << "Error: Invalid value for option " << static_cast<char>(opt) << "\n";
+            return 1;
+        }
+    }
+
+    if (trace_prefix.empty()) {
+        std::cerr << "Error: Missing required arguments\n";
+        return 1;
+    }
+    if (interval_length == 0 || max_clusters == 0 || region_bits >= 64 || paddr_bits > 64) {
+        std::cerr << "Error: -n and -k must be positive , --region-bits below 64 and --paddr-bits at most 64\n";
+        return 1;
+    }
+
+    std::vector<Access> traces[4];
+    uint64_t longest = 0;
+    for (int i = 0; i < 4; i++) {
+        std::string filename = trace_prefix + "_proc" + std::to_string(i) + ".trace";
+        if (!read_trace_accesses(filename, paddr_bits, traces[i])) {
+            std::cerr << "Error: Trace file " << filename << " does not exist or cannot be opened\n";
+            return 1;
+        }
+        longest = std::max<uint64_t>(longest, traces[i].size());
+    }
+    if (longest == 0) {
+        std::cerr << "Error: the traces of " << trace_prefix << " are empty\n";
+        return 1;
+    }
+
+    SimPointSet set;
+    set.interval_length = interval_length;
+    set.intervals = (longest + interval_length - 1) / interval_length;
+    std::vector<Signature> signatures = build_signatures(traces, interval_length, set.intervals, region_bits);
+
+    // the fewest clusters that get 90% of the way from one cluster to the most clusters , measured in squared error
+    uint32_t most = static_cast<uint32_t>(std::min<uint64_t>(max_clusters, set.intervals));
+    std::vector<Clustering> tried;
+    for (uint32_t k = 1; k <= most; k++) tried.push_back(kmeans(signatures, k));
+    const Clustering* chosen = &tried.back();
+    for (const auto& clustering : tried) {
+        if (clustering.error - tried.back().error <= 0.1 * (tried.front().error - tried.back().error)) {
+            chosen = &clustering;
+            break;
+        }
+    }
+
+    for (uint32_t c = 0; c < chosen->centres.size(); c++) {
+        SimPoint point{0, 0};
+        double best_distance = std::numeric_limits<double>::max();
+        for (uint64_t i = 0; i < set.intervals; i++) {
+            if (chosen->assignment[i] != c) continue;
+            point.cluster_size++;
+            double d = distance2(signatures[i], chosen->centres[c]);
+            if (d < best_distance) {
+                best_distance = d;
+                point.interval = i;
+            }
+        }
+        if (point.cluster_size > 0) set.points.push_back(point);
+    }
+    std::sort(set.points.begin(), set.points.end(), [](const SimPoint& a, const SimPoint& b) { return a.interval < b.interval; });
+
+    std::string filename = trace_prefix + ".simpoints";
+    if (!write_simpoints(filename, set)) {
+        std::cerr << "Error: Cannot open output file " << filename << "\n";
+        return 1;
+    }
+    std::cout << filename << ": " << set.points.size() << " representatives of " << set.intervals << " intervals of "
+              << interval_length << " accesses per core\n";
+    for (const auto& point : set.points) {
+        std::cout << "  interval " << point.interval << " weight " << std::fixed << std::setprecision(4)
+                  << (double)point.cluster_size / set.intervals << "\n";
+    }
+    return 0;
+}
@@ -1,636 +1,528 @@
-#include <iostream>
-#include <fstream>
-#include <vector>
-#include <queue>
-#include <map>
-#include <cmath>
-#include <functional>
-#include <iomanip>
-#include <algorithm>
+#include "cachesim.hpp"
 #include <getopt.h>
-#include <cstdint> 
-
-// thsi is to describe the states 
-
-enum class MESIState { INVALID, SHARED, EXCLUSIVE, MODIFIED };
-// this is to update the bus opertion 
-enum class BusOperation { BUS_READ, BUS_READX, BUS_UPDATE, INVALIDATE, FLUSH };
-
-
-// this is the struct defining elemsents for each cache line
-struct CacheLine {
-    uint32_t tag;
-    bool valid;
-    bool dirty;
-    MESIState state;
-    uint32_t lru_counter;
-    std::vector<uint8_t> data;
+#include <cstdio>
+#include <chrono>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+// what a batch run keeps of one application , the numbers of the per core table and the bus summary
+struct RunSummary {
+    CoreStats cores[4];
+    uint64_t bus_transactions = 0;
+    uint64_t bus_traffic = 0;
+    uint64_t max_execution_time = 0;
+    double wall_seconds = 0;
+    int status = 0;
 };
 
+std::vector<std::string> trace_file_names(const std::string& trace_prefix, const std::string& extension) {
+    std::vector<std::string> files;
+    for (int i = 0; i < 4; i++) files.push_back(trace_prefix + "_proc" + std::to_string(i) + extension);
+    return files;
+}
 
-// this is the parameetrs for a bus transaction which is updated after snooping adn my instruction is processed accordingly 
-struct BusTransaction {
-    BusOperation operation;
-    uint32_t address;
-    int originating_core;
-    int remaining_cycles;
-    std::vector<uint8_t> data;
-    BusTransaction() : operation(BusOperation::BUS_UPDATE), address(0), originating_core(-1), remaining_cycles(0) {}
-};
+// a filtered trace can stand in for the raw one only if trace_filter ran with the same cache and index function ,
+// and only when nothing needs to see the single hits of a run (the miss classifier and the set heatmap do)
+bool use_filtered_traces(const std::vector<std::string>& files, uint32_t s, uint32_t E, uint32_t b, const SimOptions& options) {
+    if (options.classify_misses || !options.set_heatmap_file.empty() || options.index_mode == IndexMode::SKEWED ||
+        options.tlb.enabled() || options.l2.enabled() || options.sectors > 1 || options.write_through || !options.write_allocate) {
+        std::cerr << "Warning: --filtered does not work with --classify-misses, --set-heatmap, --tlb, --l2, --sectors, a write policy other than write back write allocate or skewed indexing , using the raw traces\n";
+        return false;
+    }
+    std::string expected = "# filtered " + std::to_string(s) + " " + std::to_string(E) + " " + std::to_string(b) + " " +
+                           index_mode_name(options.index_mode) + " " + std::to_string(options.paddr_bits);
+    for (const auto& file : files) {
+        std::ifstream f(file);
+        std::string header;
+        if (!std::getline(f, header) || header != expected) {
+            std::cerr << "Warning: " << file << " is missing or was filtered for another cache , using the raw traces\n";
+            return false;
+        }
+    }
+    return true;
+}
 
+// <L1 entries>:<L1 ways>,<L2 entries>:<L2 ways> , every level needs a whole number of sets
+bool parse_tlb(const std::string& text, TlbConfig& config) {
+    unsigned l1_entries, l1_ways, l2_entries, l2_ways;
+    char end;
+    if (std::sscanf(text.c_str(), "%u:%u,%u:%u%c", &l1_entries, &l1_ways, &l2_entries, &l2_ways, &end) != 4) return false;
+    if (l1_ways == 0 || l2_ways == 0 || l1_entries < l1_ways || l2_entries < l2_ways ||
+        l1_entries % l1_ways != 0 || l2_entries % l2_ways != 0) return false;
+    config.l1_entries = l1_entries;
+    config.l1_ways = l1_ways;
+    config.l2_entries = l2_entries;
+    config.l2_ways = l2_ways;
+    return true;
+}
 
-// this si to keep track of statistics fo all cores throughout the process
-struct CoreStats {
-    uint64_t read_count = 0;
-    uint64_t write_count = 0;
-    uint64_t hit_count = 0;
-    uint64_t miss_count = 0;
-    uint64_t eviction_count = 0;
-    uint64_t writeback_count = 0;
-    uint64_t idle_cycles = 0;
-    uint64_t total_cycles = 0;
-    uint64_t invalidations = 0;
-    uint64_t data_traffic = 0;
+// wall time of the phases of one run for --profile , simulate includes the reference engine when verifying
+struct PhaseTimes {
+    double load = 0;
+    double simulate = 0;
+    double output = 0;
 };
 
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
 
-// this is my cache class , it includes all the parametrs along with the functions i need to access the cache and update it
-// and also to handle the bus transactions
-class Cache {
-public:
-    int core_id;
-    uint32_t sets;
-    uint32_t associativity;
-    uint32_t block_size;
-    uint32_t index_bits;
-    uint32_t block_offset_bits;
-    std::vector<std::vector<CacheLine>> cache_lines;
-    CoreStats stats;
-    uint32_t current_lru_counter;
-
-public:
-// this defines by cache basic structure with tis assosciativity adn block slze adn no. of blocks
-    Cache(int id, uint32_t s, uint32_t E, uint32_t b) 
-        : core_id(id), sets(1 << s), associativity(E), block_size(1 << b),
-          index_bits(s), block_offset_bits(b), current_lru_counter(0) {
-        cache_lines.resize(sets, std::vector<CacheLine>(associativity));
-        for (auto& set : cache_lines) {
-            for (auto& line : set) {
-                line.valid = false;
-                line.dirty = false;
-                line.state = MESIState::INVALID;
-                line.lru_counter = 0;
-                line.data.resize(block_size);
-            }
-        }
+// the phase times with the simulation speed , then the hot path counters of every core
+template <class SimT>
+void print_profile(std::ostream& out, bool csv_format, const SimT& simulator, const PhaseTimes& phases) {
+    uint64_t accesses = 0, snoops = 0, probes = 0;
+    for (int i = 0; i < 4; i++) {
+        const CoreStats& stats = simulator.cores[i].cache.stats;
+        accesses += stats.read_count + stats.write_count;
+        snoops += simulator.snoops_performed[i] + simulator.snoops_filtered[i];
+        probes += simulator.snoops_performed[i];
     }
+    auto rate = [](double count, double seconds) { return seconds > 0 ? count / seconds : 0.0; };
+    auto ratio = [](uint64_t count, uint64_t total) { return total > 0 ? (double)count / total : 0.0; };
+    uint64_t transactions = simulator.snooped_transactions;
 
-
-// this function is used for hits adn misses in my caches and return that if i need to access the bus or not , it getes retured value to function cycle
-
-    std::pair<bool,int> access(uint32_t address, bool is_write, BusTransaction& bus_trans,bool bus_empty) {
-        uint32_t tag = address >> (index_bits + block_offset_bits);
-        uint32_t index = (address >> block_offset_bits) & ((1 << index_bits) - 1);
-        if (index >= sets) {
-            std::cerr << "Core " << core_id << ": Invalid cache index " << index << " for address 0x" << std::hex << address << std::dec << "\n";
-            return {false, 1};
+    if (csv_format) {
+        out << "\nProfile,Value\n";
+        out << std::fixed << std::setprecision(6);
+        out << "Load_Seconds," << phases.load << "\n";
+        out << "Simulate_Seconds," << phases.simulate << "\n";
+        out << "Output_Seconds," << phases.output << "\n";
+        out << std::setprecision(0);
+        out << "Loaded_Accesses_Per_Second," << rate(accesses, phases.load) << "\n";
+        out << "Simulated_Cycles_Per_Second," << rate(simulator.global_cycle, phases.simulate) << "\n";
+        out << "Simulated_Accesses_Per_Second," << rate(accesses, phases.simulate) << "\n";
+        out << "Snooped_Transactions," << transactions << "\n";
+        out << std::setprecision(3);
+        out << "Snoops_Per_Transaction," << ratio(snoops, transactions) << "\n";
+        out << "Probes_Per_Transaction," << ratio(probes, transactions) << "\n";
+        out << "\nCore,Lookups,Average_Scan_Length,Snoop_Lookups,Average_Snoop_Scan_Length,Stall_Spins,Bus_Wait_Spins\n";
+        for (int i = 0; i < 4; i++) {
+            const ProfileCounters& profile = simulator.cores[i].cache.profile;
+            out << i << ","
+                << profile.lookups << ","
+                << ratio(profile.lines_scanned, profile.lookups) << ","
+                << profile.snoop_lookups << ","
+                << ratio(profile.snoop_lines_scanned, profile.snoop_lookups) << ","
+                << profile.stall_spins << ","
+                << profile.bus_wait_spins << "\n";
         }
+        return;
+    }
 
-        bus_trans.operation = BusOperation::BUS_UPDATE;
-
-        for (auto& line : cache_lines[index]) {
-            if (line.valid && line.tag == tag) {
-                line.lru_counter = ++current_lru_counter;
-                if (is_write) {
-                    if (line.state == MESIState::SHARED) {
-                        if(bus_empty){
-                        bus_trans.operation = BusOperation::INVALIDATE;
-                        bus_trans.address = address;
-                        line.state = MESIState::MODIFIED;
-                        line.dirty = true;
-                        return {true, 1};
-                    }
-                    else {
-                        line.lru_counter = --current_lru_counter;
-                        bus_trans.address = address;
-                        return {false, 1};
-                    }
-                    }
-                    else {
-                        line.state = MESIState::MODIFIED;
-                        line.dirty = true;
-                    }
-                }
-                return {true, 1};
-            }
-        }
+    out << "\nProfile:\n";
+    out << std::fixed << std::setprecision(3);
+    out << "Load Traces: " << phases.load << " s (" << std::setprecision(0) << rate(accesses, phases.load) << " accesses/s)\n";
+    out << std::setprecision(3) << "Simulate: " << phases.simulate << " s (" << std::setprecision(0)
+        << rate(simulator.global_cycle, phases.simulate) << " cycles/s, " << rate(accesses, phases.simulate) << " accesses/s)\n";
+    out << std::setprecision(3) << "Output: " << phases.output << " s\n";
+    out << "Snoops per Transaction: " << ratio(snoops, transactions) << " (" << ratio(probes, transactions)
+        << " probed) over " << transactions << " transactions\n";
+    for (int i = 0; i < 4; i++) {
+        const ProfileCounters& profile = simulator.cores[i].cache.profile;
+        out << "Core " << i << ": " << profile.lookups << " lookups scanning " << ratio(profile.lines_scanned, profile.lookups)
+            << " lines, " << profile.snoop_lookups << " snoop lookups scanning "
+            << ratio(profile.snoop_lines_scanned, profile.snoop_lookups) << " lines, " << profile.stall_spins
+            << " stall spins, " << profile.bus_wait_spins << " bus wait spins\n";
+    }
+}
 
-        // stats.miss_count++;
-        bus_trans.operation = is_write ? BusOperation::BUS_READX : BusOperation::BUS_READ;
-        bus_trans.address = address;
-        return {false, 1};
+// the .ftrace files when --filtered was given and they fit the cache , the raw traces otherwise
+std::vector<std::string> pick_trace_files(const std::string& trace_prefix, uint32_t s, uint32_t E, uint32_t b, SimOptions& options) {
+    if (options.filtered_traces) {
+        options.filtered_traces = use_filtered_traces(trace_file_names(trace_prefix, ".ftrace"), s, E, b, options);
+        if (options.filtered_traces) return trace_file_names(trace_prefix, ".ftrace");
     }
+    return trace_file_names(trace_prefix, ".trace");
+}
 
+// <sockets>:<link latency>:<link bytes per cycle> , the sockets have to split the four cores evenly
+bool parse_numa(const std::string& text, NumaConfig& config) {
+    unsigned sockets, latency, bandwidth;
+    char end;
+    if (std::sscanf(text.c_str(), "%u:%u:%u%c", &sockets, &latency, &bandwidth, &end) != 3) return false;
+    if ((sockets != 1 && sockets != 2 && sockets != 4) || bandwidth == 0) return false;
+    config.sockets = sockets;
+    config.link_latency = latency;
+    config.link_bytes_per_cycle = bandwidth;
+    return true;
+}
 
-    // this function is called by handle_nus_read and in this i am updating the snooping operation , i.e checking for each core it is called 
-    void handle_bus_transaction(BusTransaction& trans, BusTransaction& response) {
-        uint32_t tag = trans.address >> (index_bits + block_offset_bits);
-        uint32_t index = (trans.address >> block_offset_bits) & ((1 << index_bits) - 1);
-        if (index >= sets) {
-            std::cerr << "Core " << core_id << ": Invalid bus transaction index " << index << " for address 0x" << std::hex << trans.address << std::dec << "\n";
-            return;
-        }
+// <set bits>:<ways>:<inclusive|exclusive|nine>
+bool parse_l2(const std::string& text, L2Config& config) {
+    unsigned set_bits, ways;
+    char policy[16];
+    if (std::sscanf(text.c_str(), "%u:%u:%15s", &set_bits, &ways, policy) != 3 || set_bits == 0 || set_bits > 24 || ways == 0) return false;
+    std::string name = policy;
+    if (name == "inclusive") config.policy = InclusionPolicy::INCLUSIVE;
+    else if (name == "exclusive") config.policy = InclusionPolicy::EXCLUSIVE;
+    else if (name == "nine") config.policy = InclusionPolicy::NINE;
+    else return false;
+    config.set_bits = set_bits;
+    config.ways = ways;
+    return true;
+}
 
-        for (auto& line : cache_lines[index]) {
-            if (line.valid && line.tag == tag) {
-                switch (trans.operation) {
-                    case BusOperation::BUS_READ:
-                        if (line.state == MESIState::MODIFIED) {
-                            stats.writeback_count++;
-                            response.operation = BusOperation::FLUSH;
-                            response.data = line.data;
-                            line.state = MESIState::SHARED;
-                            // stats.data_traffic += block_size;
-                        } else if (line.state == MESIState::EXCLUSIVE || line.state == MESIState::SHARED) {
-                            response.data = line.data;
-                            line.state = MESIState::SHARED;
-                            // stats.data_traffic += block_size;
-                        }
-                        break;
-                    case BusOperation::BUS_READX:
-                        line.state = MESIState::INVALID;
-                        line.valid = false;
-                        if (line.dirty) {
-                            stats.writeback_count++;
-                            response.operation = BusOperation::FLUSH;
-                            response.data = line.data;
-                            // stats.data_traffic += block_size;
-                        }
-                        break;
-                    case BusOperation::INVALIDATE:
-                        line.state = MESIState::INVALID;
-                        line.valid = false;
-                        stats.invalidations++;
-                        // stats.invalidations++;
-                        break;
-                    default:
-                        break;
-                }
-                return;
+// this sets up the simulator for one cache type , runs it and prints the stats
+// the text report goes to report unless it is null , and a batch run gets the numbers back through summary
+template <class CacheT>
+int run_simulation(uint32_t s, uint32_t E, uint32_t b, const std::vector<std::string>& trace_files,
+                   const std::string& trace_prefix, const SimOptions& options, const std::string& outfilename,
+                   std::ostream* report, RunSummary* summary) {
+    PhaseTimes phases;
+    auto phase_start = std::chrono::steady_clock::now();
+    Simulator<CacheT> simulator(s, E, b, trace_files, trace_prefix, options);
+    phases.load = seconds_since(phase_start);
+
+    phase_start = std::chrono::steady_clock::now();
+    if (options.verify_checkpoint > 0) {
+        // the reference runs the generic engine without the snoop filter and the output options
+        // filtered traces are checked against the raw ones , and only at the end since the hit runs skip ahead
+        SimOptions ref_options = reference_options(options);
+        ref_options.filtered_traces = false;
+        Simulator<Cache<>> reference(s, E, b, options.filtered_traces ? trace_file_names(trace_prefix, ".trace") : trace_files,
+                                     trace_prefix, ref_options);
+        Divergence divergence = run_lockstep(reference, simulator, options.filtered_traces ? 0 : options.verify_checkpoint);
+        std::ostream& out = report ? *report : std::cerr;
+        if (divergence.found) {
+            out << "Verification failed at cycle " << divergence.cycle;
+            if (divergence.core >= 0) {
+                out << " on core " << divergence.core << " after " << divergence.access << " accesses";
             }
+            out << ": " << divergence.what << "\n";
+            return 2;
         }
+        if (report) *report << "Verification: reference and optimized engines agree over " << simulator.global_cycle << " cycles\n";
+        if (options.interval_cycles > 0) simulator.write_interval();
+    } else {
+        simulator.run();
     }
+    phases.simulate = seconds_since(phase_start);
 
-
-    // it is used to install the block in the cache and update the stats accordingly and also checks for cache evictions if needed 
-    int install_block(uint32_t address, const std::vector<uint8_t>& data, MESIState state,  uint64_t* total_bus_traffic) {
-        uint32_t tag = address >> (index_bits + block_offset_bits);
-        uint32_t index = (address >> block_offset_bits) & ((1 << index_bits) - 1);
-        if (index >= sets) {
-            std::cerr << "Core " << core_id << ": Invalid install index " << index << " for address 0x" << std::hex << address << std::dec << "\n";
-            return 0;
+    phase_start = std::chrono::steady_clock::now();
+    if (!outfilename.empty()) {
+        std::ofstream outfile(outfilename);
+        if (!outfile) {
+            std::cerr << "Error: Cannot open output file " << outfilename << "\n";
+            return 1;
         }
-
-        CacheLine* target = nullptr;
-        for (auto& line : cache_lines[index]) {
-            if (!line.valid) {
-                target = &line;
-                break;
-            }
-            if (!target || line.lru_counter < target->lru_counter) {
-                target = &line;
-            }
+        simulator.print_stats(outfile, true);
+        outfile.close();
+    }
+    if (report) simulator.print_stats(*report, false);
+    phases.output = seconds_since(phase_start);
+
+    // the profile comes last so it can include the time spent writing the stats
+    if (options.profile) {
+        if (!outfilename.empty()) {
+            std::ofstream outfile(outfilename, std::ios::app);
+            print_profile(outfile, true, simulator, phases);
         }
+        if (report) print_profile(*report, false, simulator, phases);
+    }
+    if (summary) {
+        for (int i = 0; i < 4; i++) summary->cores[i] = simulator.cores[i].cache.stats;
+        summary->bus_transactions = simulator.total_bus_transactions;
+        summary->bus_traffic = simulator.total_bus_traffic;
+        summary->max_execution_time = simulator.get_max_execution_time();
+    }
 
-        int eviction_cycles = 0;
-        if (target->valid) {
-            stats.eviction_count++;
-            if (target->dirty) {
-                stats.writeback_count++;
-                eviction_cycles += 100;
-            }
+    if (!options.set_heatmap_file.empty()) {
+        std::ofstream heatmap(options.set_heatmap_file);
+        if (!heatmap) {
+            std::cerr << "Error: Cannot open set heatmap file " << options.set_heatmap_file << "\n";
+            return 1;
         }
-
-        target->valid = true;
-        target->tag = tag;
-        target->dirty = false;
-        target->state = state;
-        target->lru_counter = ++current_lru_counter;
-        target->data = data;
-        stats.data_traffic += block_size*8;
-        total_bus_traffic += block_size*8;
-
-        return eviction_cycles;
+        simulator.write_set_heatmap(heatmap);
     }
-};
 
+    return 0;
+}
 
-// this is the core class which includes the cache and the instructions queue and also the stall cycles and bus transactions
-// this is the main class which is used to load the traces and run the cycles
-class Core {
+// a pool of worker threads with one job deque each , a worker takes jobs from the back of its own deque and steals
+// from the front of the others once it runs dry , so a few long applications do not leave the other threads idle
+class WorkStealingPool {
 public:
-    int id;
-    Cache cache;
-    std::queue<std::pair<bool, uint32_t>> instructions;
-    int stall_cycles = 0;
-    bool waiting_for_bus = false;
-    BusTransaction pending_bus_trans;
+    explicit WorkStealingPool(size_t threads) : queues(std::max<size_t>(1, threads)) {}
+
+    // jobs are handed out in order round robin , so the ones listed first start first
+    void run(const std::vector<size_t>& jobs, const std::function<void(size_t)>& job) {
+        for (size_t i = 0; i < jobs.size(); i++) queues[i % queues.size()].jobs.push_back(jobs[i]);
+        std::vector<std::thread> workers;
+        for (size_t w = 0; w < queues.size(); w++) {
+            workers.emplace_back([this, w, &job]() {
+                size_t next;
+                while (take(w, next)) job(next);
+            });
+        }
+        for (auto& worker : workers) worker.join();
+    }
 
-public:
-    Core(int id, uint32_t s, uint32_t E, uint32_t b) : id(id), cache(id, s, E, b) {}
-// here i am loadaing the trace files along with W and R and updating the total instructions, write instructions adn read instructions
-    size_t load_trace(const std::string& filename) {
-        std::ifstream file(filename);
-        char op;
-        uint32_t addr;
-        size_t count = 0;
-        while (file >> op >> std::hex >> addr) {
-            if (op != 'R' && op != 'W') {
-                std::cerr << "Invalid operation " << op << " in " << filename << "\n";
-                continue;
+private:
+    struct JobQueue {
+        std::mutex lock;
+        std::deque<size_t> jobs;
+    };
+    std::vector<JobQueue> queues;
+
+    // nothing is added once the workers run , so a worker that finds every deque empty is done
+    bool take(size_t worker, size_t& next) {
+        {
+            JobQueue& own = queues[worker];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (!own.jobs.empty()) {
+                next = own.jobs.back();
+                own.jobs.pop_back();
+                return true;
             }
-            if(op == 'R') {
-                cache.stats.read_count++;
-            } else {
-                cache.stats.write_count++;
+        }
+        for (size_t k = 1; k < queues.size(); k++) {
+            JobQueue& victim = queues[(worker + k) % queues.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.jobs.empty()) {
+                next = victim.jobs.front();
+                victim.jobs.pop_front();
+                return true;
             }
-
-            instructions.emplace(op == 'W', addr);
-            count++;
         }
-        return count;
+        return false;
     }
+};
 
-    // it is to check if current core is stalled 
-    bool is_stalled() { return stall_cycles > 0; }
-
-    // it is check if my current core hasd further instructions to be executed or not
-    bool has_next_instruction() const { return !instructions.empty(); }
-
-    // it is called at the first and by each core , it calls access to finally  update if i got a miss or hit and returns that to run function where i process it further 
-    std::pair<bool, BusTransaction> cycle(bool bus_empty) {
-    if (stall_cycles >0) {
-        // cache.stats.idle_cycles++;
-        return {false, BusTransaction()};
+// every <name>_proc0.trace in the directory that has its three other traces next to it , sorted by name
+std::vector<std::string> find_trace_prefixes(const std::string& directory) {
+    std::vector<std::string> prefixes;
+    const std::string suffix = "_proc0.trace";
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        std::string name = entry.path().filename().string();
+        if (name.size() <= suffix.size() || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) continue;
+        std::string prefix = (entry.path().parent_path() / name.substr(0, name.size() - suffix.size())).string();
+        bool complete = true;
+        for (const auto& file : trace_file_names(prefix, ".trace")) complete = complete && std::filesystem::exists(file);
+        if (complete) prefixes.push_back(prefix);
     }
+    std::sort(prefixes.begin(), prefixes.end());
+    return prefixes;
+}
 
-    if (instructions.empty()) {
-        // cache.stats.idle_cycles++;
-        return {false, BusTransaction()};
+// runs every application of the directory on the pool and writes one csv with a row per core of every application ,
+// followed by a summary row per application which is also printed
+int run_batch(const std::string& directory, uint32_t s, uint32_t E, uint32_t b, const SimOptions& options,
+              const std::string& outfilename, size_t threads) {
+    std::vector<std::string> prefixes = find_trace_prefixes(directory);
+    if (prefixes.empty()) {
+        std::cerr << "Error: no <app>_proc0..3.trace files found in " << directory << "\n";
+        return 1;
     }
 
-    auto [is_write, addr] = instructions.front();
-    auto [hit, latency] = cache.access(addr, is_write, pending_bus_trans,bus_empty);
-
-    // returning updated state both in acse of hit and miss
-    if (hit) {
-        instructions.pop();
-        cache.stats.hit_count++;
-        pending_bus_trans.originating_core = id;
-        return {true, pending_bus_trans};
-    } else {
-        pending_bus_trans.originating_core = id;
-        // waiting_for_bus = true;
-        return {false,pending_bus_trans};
+    // the biggest applications go first so they do not end up as the last job of a thread
+    std::vector<uintmax_t> trace_bytes(prefixes.size(), 0);
+    std::vector<size_t> order(prefixes.size());
+    for (size_t i = 0; i < prefixes.size(); i++) {
+        order[i] = i;
+        std::error_code error;
+        for (const auto& file : trace_file_names(prefixes[i], ".trace")) trace_bytes[i] += std::filesystem::file_size(file, error);
     }
-}
-
-    int get_id() const { return id; }
-};
-
-
-// this is the main simulator class which includes all the cores and the bus transactions and the global cycle and the stats for each core
-// this is the main class which runs the simulation and handles the bus transactions and the cores and also the stats
-// in my bus i can contain only one instruction at a time 
-class Simulator {
-public:
-    std::vector<Core> cores;
-    std::queue<BusTransaction> bus_queue;
-    BusTransaction current_bus_trans;
-    int bus_busy_cycles = 0;
-    uint64_t global_cycle = 0;
-    uint64_t total_bus_transactions = 0;
-    uint64_t total_invalidations = 0;
-    uint64_t total_bus_traffic = 0;
-    std::string trace_prefix;
-    uint32_t set_index_bits;
-    uint32_t associativity;
-    uint32_t block_bits;
-    uint32_t block_size;
-    uint32_t num_sets;
-    double cache_size_kb;
-
-public:
-// here it calls each core to set up its cacahe and load the traces
-    Simulator(uint32_t s, uint32_t E, uint32_t b, const std::vector<std::string>& trace_files, const std::string& prefix)
-        : trace_prefix(prefix), set_index_bits(s), associativity(E), block_bits(b), block_size(1 << b),
-          num_sets(1 << s), cache_size_kb((1 << s) * E * (1 << b) / 1024.0) {
-        for (int i = 0; i < 4; i++) {
-            cores.emplace_back(i, s, E, b);
-            size_t count = cores[i].load_trace(trace_files[i]);
-            // std::cerr << "Core " << i << " loaded " << count << " instructions from " << trace_files[i] << "\n";
-            // if (count == 0) {
-            //     std::cerr << "Warning: No instructions loaded for Core " << i << "\n";
-            // }
+    std::stable_sort(order.begin(), order.end(), [&](size_t x, size_t y) { return trace_bytes[x] > trace_bytes[y]; });
+
+    std::vector<RunSummary> results(prefixes.size());
+    std::mutex error_lock;
+    auto start = std::chrono::steady_clock::now();
+    WorkStealingPool pool(threads);
+    pool.run(order, [&](size_t i) {
+        auto job_start = std::chrono::steady_clock::now();
+        SimOptions app_options = options;
+        std::vector<std::string> trace_files;
+        {
+            // the fallback warnings of --filtered are printed here , one application at a time
+            std::lock_guard<std::mutex> guard(error_lock);
+            trace_files = pick_trace_files(prefixes[i], s, E, b, app_options);
         }
+        results[i].status = run_simulation<Cache<>>(s, E, b, trace_files, prefixes[i], app_options, "", nullptr, &results[i]);
+        results[i].wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - job_start).count();
+    });
+    double total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::ofstream outfile(outfilename);
+    if (!outfile) {
+        std::cerr << "Error: Cannot open output file " << outfilename << "\n";
+        return 1;
     }
-// it is to check at last if all cores are finished 
-    bool all_cores_finished() const {
-        for (const auto& core : cores) {
-            if (core.has_next_instruction()) return false;
-        }
-        return bus_queue.empty() && bus_busy_cycles == 0;
-    }
-
-    // it is to handle the bus read and update the stats accordingly and also check for the data provided or not
-    // it calls handle_bus_transactions adn it tellls it what to do, it accordingly updates the bus_busy_cyclre adn stall cyles for the required cores and also the data traffic
-    // it also updates the final state of the cache line and also the data provided if any
-    int handle_bus_read() {
-        bool data_provided = false;
-        std::vector<uint8_t> response_data;
-        MESIState final_state = MESIState::SHARED;
-        int total_cycles = 0;
-        int installing_cycles=0;
-
-        for (auto& core : cores) {
-            if (core.get_id() == current_bus_trans.originating_core) {
-
-                if(current_bus_trans.operation == BusOperation::INVALIDATE){
-                    total_invalidations++;
-                    cores[current_bus_trans.originating_core].cache.stats.invalidations++;
-                    total_bus_transactions++;
-                    cores[current_bus_trans.originating_core].instructions.pop();
-                    // cores[current_bus_trans.originating_core].waiting_for_bus = false;
-                }
-                continue;
-            }
-            BusTransaction response;
-            core.cache.handle_bus_transaction(current_bus_trans, response);
-
-            if (current_bus_trans.operation == BusOperation::BUS_READ) {
-                if (response.operation == BusOperation::FLUSH) {
-                    response_data = response.data;
-                    data_provided = true;
-                    core.stall_cycles = 100 + 2*(block_size / 4); 
-                    core.cache.stats.data_traffic += block_size*8;
-                    cores[current_bus_trans.originating_core].stall_cycles = 2*(block_size / 4);
-                    total_cycles += 100 + 2 * (block_size / 4);
-                    final_state = MESIState::SHARED;
-                    total_bus_traffic += block_size*8;
-                    break;
-                } else if (!response.data.empty()) {
-                    response_data = response.data;
-                    data_provided = true;
-                    total_cycles += 2 * (block_size / 4);
-                    core.cache.stats.data_traffic += block_size*8;
-                    cores[current_bus_trans.originating_core].cache.stats.data_traffic += block_size*8;
-                    core.stall_cycles = 2*(block_size / 4);
-                    cores[current_bus_trans.originating_core].stall_cycles = 2*(block_size / 4);
-                    final_state = MESIState::SHARED;
-                    // total_bus_traffic += block_size;
-                    break;
-                }
-            } else if (current_bus_trans.operation == BusOperation::BUS_READX) {
-                if (response.operation == BusOperation::FLUSH) {
-                    total_cycles += 100;
-                    core.stall_cycles = 100;  // dusra core ko next 100 ke liye stall karna hai just chaneg it after wards 
-                    core.cache.stats.data_traffic += block_size*8;
-                    cores[current_bus_trans.originating_core].stall_cycles=100;
-                    total_bus_traffic += block_size*8;
-                }
-                final_state = MESIState::MODIFIED;
-            }
- 
-        }
-        if(current_bus_trans.operation != BusOperation::INVALIDATE){
-        if (!data_provided) {
-            // if(current_bus_trans.originating_core ==0){
-            //     printf(" i am here\n");
-            // }
-            response_data = std::vector<uint8_t>(block_size, 0);
-            total_cycles += 100;
-            cores[current_bus_trans.originating_core].cache.stats.data_traffic += block_size*8;
-            cores[current_bus_trans.originating_core].stall_cycles += 100;
-            final_state = (current_bus_trans.operation == BusOperation::BUS_READX) ? 
-                          MESIState::MODIFIED : MESIState::EXCLUSIVE;
-            total_bus_traffic += block_size;
+    outfile << "Parameter,Value\n";
+    outfile << "Trace_Directory," << directory << "\n";
+    outfile << "Set_Index_Bits," << s << "\n";
+    outfile << "Associativity," << E << "\n";
+    outfile << "Block_Bits," << b << "\n";
+    outfile << "Applications," << prefixes.size() << "\n";
+    outfile << "Threads," << std::max<size_t>(1, threads) << "\n";
+    outfile << "\nTrace_Prefix,Core,Total_Instructions,Reads,Writes,Total_Execution_Cycles,Idle_Cycles,Misses,Miss_Rate,Evictions,Writebacks,Invalidations,Data_Traffic\n";
+    for (size_t i = 0; i < prefixes.size(); i++) {
+        std::string name = std::filesystem::path(prefixes[i]).filename().string();
+        for (int c = 0; c < 4; c++) {
+            const CoreStats& stats = results[i].cores[c];
+            double miss_rate = (stats.hit_count + stats.miss_count) > 0 ?
+                (double)stats.miss_count / (stats.hit_count + stats.miss_count) * 100 : 0;
+            outfile << name << "," << c << ","
+                    << stats.read_count + stats.write_count << ","
+                    << stats.read_count << ","
+                    << stats.write_count << ","
+                    << stats.total_cycles << ","
+                    << stats.idle_cycles << ","
+                    << stats.miss_count << ","
+                    << std::fixed << std::setprecision(2) << miss_rate << ","
+                    << stats.eviction_count << ","
+                    << stats.writeback_count << ","
+                    << stats.invalidations << ","
+                    << stats.data_traffic << "\n";
         }
+    }
 
-        installing_cycles += cores[current_bus_trans.originating_core].cache.install_block(
-            current_bus_trans.address, response_data, final_state, & total_bus_traffic);
-        total_cycles += installing_cycles;
-        cores[current_bus_trans.originating_core].stall_cycles += installing_cycles;
-
+    int status = 0;
+    outfile << "\nTrace_Prefix,Status,Total_Instructions,Misses,Miss_Rate,Max_Execution_Time,Total_Bus_Transactions,Total_Bus_Traffic_Bytes,Wall_Seconds\n";
+    std::cout << std::fixed << "Application      Instructions   Miss Rate  Max Execution Time  Bus Transactions  Wall Seconds\n";
+    for (size_t i = 0; i < prefixes.size(); i++) {
+        const RunSummary& result = results[i];
+        std::string name = std::filesystem::path(prefixes[i]).filename().string();
+        uint64_t instructions = 0, misses = 0, accesses = 0;
+        for (const auto& stats : result.cores) {
+            instructions += stats.read_count + stats.write_count;
+            misses += stats.miss_count;
+            accesses += stats.hit_count + stats.miss_count;
         }
-
-        return total_cycles;
+        double miss_rate = accesses > 0 ? (double)misses / accesses * 100 : 0;
+        outfile << name << "," << (result.status == 0 ? "ok" : "failed") << ","
+                << instructions << ","
+                << misses << ","
+                << std::fixed << std::setprecision(2) << miss_rate << ","
+                << result.max_execution_time << ","
+                << result.bus_transactions << ","
+                << result.bus_traffic << ","
+                << std::setprecision(3) << result.wall_seconds << "\n";
+        std::cout << std::left << std::setw(16) << name << std::right
+                  << std::setw(13) << instructions
+                  << std::setw(11) << std::setprecision(2) << miss_rate << "%"
+                  << std::setw(20) << result.max_execution_time
+                  << std::setw(18) << result.bus_transactions
+                  << std::setw(14) << std::setprecision(3) << result.wall_seconds
+                  << (result.status == 0 ? "" : "  failed") << "\n";
+        if (result.status != 0) status = result.status;
     }
+    std::cout << prefixes.size() << " applications in " << std::setprecision(3) << total_seconds << " s on "
+              << std::max<size_t>(1, threads) << " threads , results in " << outfilename << "\n";
+    return status;
+}
 
-    // this is the main function which runs the simulation and handles the bus transactions and the cores and also the stats
-    void run() {
-        while (!all_cores_finished()) {
-            // picking up each core 
-            for (auto& core : cores) {
-                // if it is waiting for bus , i need to update the idle cycles
-                if(core.waiting_for_bus){
-                    core.cache.stats.idle_cycles++;
-                }
-                // if(core.get_id()==0 &&core.stall_cycles>0){
-                //     printf("%ld %d %d\n" , global_cycle, core.stall_cycles,bus_busy_cycles);
-                // }
-                // if the core is stalled , i wont be processing it and that would count in execution since stalling heer means when it is transfering block or is reading from memory 
-                if (core.is_stalled()){
-                    core.stall_cycles--;
-                    // core.cache.stats.idle_cycles++;
-                    core.cache.stats.total_cycles++;
-                    continue;
-                }
-
-                // here i send  it to cycle to check for hit or miss
-                auto [progress, bus_trans] = core.cycle(bus_queue.empty());
-                // here i got a miss -> in this case i only need to update the invalidate operation and for that i will get the miss only if the bus is empty 
-                // i reach to each core adn invalidate if the block is present there
-                if(progress  && bus_trans.originating_core != -1){
-                    core.cache.stats.total_cycles++;
-                    if (bus_trans.operation == BusOperation::INVALIDATE) {
-                        bus_queue.push(bus_trans);
-                        bus_busy_cycles=1;
-                        total_bus_transactions++;
-                        for (auto& other_core : cores) {
-                            if (other_core.get_id() != bus_trans.originating_core) {
-                                BusTransaction response;
-                                other_core.cache.handle_bus_transaction(bus_trans, response);
-                            }
-                        }
-                        total_invalidations++;
-                        cores[bus_trans.originating_core].cache.stats.invalidations++;
-                        cores[bus_trans.originating_core].stall_cycles=0;
-                        // cores[bus_trans.originating_core].instructions.pop();
-                        // cores[bus_trans.originating_core].waiting_for_bus = false;
-                        cores[bus_trans.originating_core].pending_bus_trans = BusTransaction();
-                        
-                    } 
-
-                }
-                // heer if i got a miss , i check i my bus is empty or not , if not i declare that it will now wait for bus and if yes it gets loaded ont he bus 
-                else if (!progress && bus_trans.originating_core != -1) {
-                    // if(core.get_id()==0){
-                    //     printf("%ld %d" , global_cycle, core.stall_cycles);
-                    // }
-                        if (bus_queue.empty()){
-                        core.cache.stats.miss_count++;
-                        bus_queue.push(bus_trans);
-                        total_bus_transactions++;
-                        core.waiting_for_bus = false ;
-                        }
-                        else {
-                            // printf("Core %d: Waiting for bus\n", core.get_id());
-                            core.waiting_for_bus = true;
-                        }
-                }
-            }
-
-
-// here bus operates on the transactions and if it was last cycle of bus it updaets teh instruction adn pops it out since it is now processed 
-            if (bus_busy_cycles > 0) {
-                bus_busy_cycles--;
-                if (bus_busy_cycles == 0 && current_bus_trans.originating_core != -1) {
-                        bus_queue.pop();
-                        auto& core = cores[current_bus_trans.originating_core];
-                        if (!core.instructions.empty()) {
-                            auto [is_write, addr] = core.instructions.front();
-                            core.instructions.pop();
-                        }
-                        // core.waiting_for_bus = false;
-                        core.stall_cycles=0;
-                        current_bus_trans = BusTransaction();
-                    }
-                else if (!bus_queue.empty() && bus_busy_cycles == 0 ) {
-                    bus_queue.pop();
-                }
-            } 
-             // here it is when the bus first fetches the bus instruction and checks fo tit , snoops for it and next state are updated accordingly 
-            else if (!bus_queue.empty() && bus_busy_cycles == 0) {
-                current_bus_trans = bus_queue.front();
-                // bus_queue.pop();
-                if (current_bus_trans.originating_core < 0 || current_bus_trans.originating_core >= 4) {
-                    std::cerr << "Invalid originating core " << current_bus_trans.originating_core << "\n";
-                    continue;
-                }
-                switch (current_bus_trans.operation) {
-                    case BusOperation::INVALIDATE:
-                        break;
-                    case BusOperation::BUS_READ:
-                    case BusOperation::BUS_READX:
-                        bus_busy_cycles = handle_bus_read();
-                        cores[current_bus_trans.originating_core].stall_cycles=bus_busy_cycles;
-                        cores[current_bus_trans.originating_core].cache.stats.data_traffic += block_size*8;
-                        total_bus_traffic += block_size*8;
-                        break;
-                    case BusOperation::FLUSH:
-                        bus_busy_cycles = 100;
-                        cores[current_bus_trans.originating_core].stall_cycles=bus_busy_cycles;
-                        cores[current_bus_trans.originating_core].cache.stats.data_traffic += block_size*8;   
-                        total_bus_traffic += block_size*8;
-                        break;
-                    default:
-                        std::cerr << "Invalid bus operation\n";
-                        break;
-                }
-            }
-            global_cycle++;
+// simulates only the representative intervals of a simpoints file , each one after a warm up of the warmup intervals
+// before it , and writes the stats of the whole run as the sum of every representative times the size of its cluster
+// the estimates go into the CoreStats of an empty simulator so they print in the usual layout
+int run_simpoints(uint32_t s, uint32_t E, uint32_t b, const std::string& trace_prefix, const SimOptions& options,
+                  const std::string& simpoint_file, uint64_t warmup, const std::string& outfilename) {
+    SimPointSet set;
+    if (!read_simpoints(simpoint_file, set)) {
+        std::cerr << "Error: " << simpoint_file << " is missing or is not a simpoints file\n";
+        return 1;
+    }
+    std::vector<Access> traces[4];
+    uint64_t total_accesses = 0;
+    std::vector<std::string> files = trace_file_names(trace_prefix, ".trace");
+    for (int i = 0; i < 4; i++) {
+        if (!read_trace_accesses(files[i], options.paddr_bits, traces[i])) {
+            std::cerr << "Error: Trace file " << files[i] << " does not exist or cannot be opened\n";
+            return 1;
         }
-        // for (auto& core : cores) {
-        //     core.cache.stats.total_cycles = global_cycle;
-        // }
-
+        total_accesses += traces[i].size();
     }
 
-// updating the max execution time for each core and returning the max cycles
-    uint64_t get_max_execution_time() const {
-            uint64_t max_cycles = 0;
-            for (const auto& core : cores) {
-                max_cycles = std::max(max_cycles, core.cache.stats.total_cycles+core.cache.stats.idle_cycles);
-            }
-            return max_cycles;
+    auto start_time = std::chrono::steady_clock::now();
+    Simulator<Cache<>> estimate(s, E, b, options);
+    estimate.trace_prefix = trace_prefix;
+    uint64_t simulated_accesses = 0;
+    std::vector<std::pair<uint64_t, uint64_t>> representative_results;
+    for (const auto& point : set.points) {
+        Simulator<Cache<>> simulator(s, E, b, options);
+        uint64_t start = point.interval * set.interval_length;
+        uint64_t warm_start = start - std::min(start, warmup * set.interval_length);
+        for (int i = 0; i < 4; i++) {
+            uint64_t first = std::min<uint64_t>(warm_start, traces[i].size());
+            uint64_t last = std::min<uint64_t>(start, traces[i].size());
+            simulator.push_accesses(i, traces[i].data() + first, last - first);
+            simulated_accesses += last - first;
         }
-// this is used to print the stats in csv format or normal format as required
-// it includes all the parameters and the stats for each core and also the overall bus summary
-    void print_stats(std::ostream& out, bool csv_format) const {
-    if (csv_format) {
-        out << "Parameter,Value\n";
-        out << "Trace_Prefix," << trace_prefix << "\n";
-        out << "Set_Index_Bits," << set_index_bits << "\n";
-        out << "Associativity," << associativity << "\n";
-        out << "Block_Bits," << block_bits << "\n";
-        out << "Block_Size_Bytes," << block_size << "\n";
-        out << "Number_of_Sets," << num_sets << "\n";
-        out << "Cache_Size_KB_per_core," << std::fixed << std::setprecision(2) << cache_size_kb << "\n";
-        out << "MESI_Protocol,Enabled\n";
-        out << "Write_Policy,Write-back Write-allocate\n";
-        out << "Replacement_Policy,LRU\n";
-        out << "Bus,Central snooping bus\n";
-        out << "\nCore,Total_Instructions,Reads,Writes,Total_Execution_Cycles,Idle_Cycles,Misses,Miss_Rate,Evictions,Writebacks,Invalidations,Data_Traffic\n";
+        simulator.run();
+        simulator.reset_stats();
         for (int i = 0; i < 4; i++) {
-            const auto& stats = cores[i].cache.stats;
-            uint64_t total_instructions = stats.read_count + stats.write_count;
-            double miss_rate = (stats.hit_count + stats.miss_count) > 0 ?
-                (double)stats.miss_count / (stats.hit_count + stats.miss_count) * 100 : 0;
-            out << i << ","
-                << total_instructions << ","
-                << stats.read_count << ","
-                << stats.write_count << ","
-                << stats.total_cycles << ","
-                << stats.idle_cycles << ","
-                << stats.miss_count << ","
-                << std::fixed << std::setprecision(2) << miss_rate << ","
-                << stats.eviction_count << ","
-                << stats.writeback_count << ","
-                << stats.invalidations << ","
-                << stats.data_traffic << "\n";
+            uint64_t first = std::min<uint64_t>(start, traces[i].size());
+            uint64_t last = std::min<uint64_t>(start + set.interval_length, traces[i].size());
+            simulator.push_accesses(i, traces[i].data() + first, last - first);
+            simulated_accesses += last - first;
         }
-        out << "\nOverall_Bus_Summary,Value\n";
-        out << "Total_Bus_Transactions," << total_bus_transactions << "\n";
-        out << "Total_Bus_Traffic_Bytes," << total_bus_traffic << "\n";
-        out << "Max_Execution_Time," << get_max_execution_time() << "\n"; // Added Max_Execution_Time
-    } else {
-        out << "Simulation Parameters:\n";
-        out << "Trace Prefix: " << trace_prefix << "\n";
-        out << "Set Index Bits: " << set_index_bits << "\n";
-        out << "Associativity: " << associativity << "\n";
-        out << "Block Bits: " << block_bits << "\n";
-        out << "Block Size (Bytes): " << block_size << "\n";
-        out << "Number of Sets: " << num_sets << "\n";
-        out << "Cache Size (KB per core): " << std::fixed << std::setprecision(2) << cache_size_kb << "\n";
-        out << "MESI Protocol: Enabled\n";
-        out << "Write Policy: Write-back, Write-allocate\n";
-        out << "Replacement Policy: LRU\n";
-        out << "Bus: Central snooping bus\n";
+        simulator.run();
+
         for (int i = 0; i < 4; i++) {
-            const auto& stats = cores[i].cache.stats;
-            uint64_t total_instructions = stats.read_count + stats.write_count;
-            double miss_rate = (stats.hit_count + stats.miss_count) > 0 ?
-                (double)stats.miss_count / (stats.hit_count + stats.miss_count) * 100 : 0;
-            out << "\nCore " << i << " Statistics:\n";
-            out << "Total Instructions: " << total_instructions << "\n";
-            out << "Total Reads: " << stats.read_count << "\n";
-            out << "Total Writes: " << stats.write_count << "\n";
-            out << "Total Execution Cycles: " << stats.total_cycles << "\n";
-            out << "Idle Cycles: " << stats.idle_cycles << "\n";
-            out << "Cache Misses: " << stats.miss_count << "\n";
-            out << "Cache Miss Rate: " << std::fixed << std::setprecision(2) << miss_rate << "%\n";
-            out << "Cache Evictions: " << stats.eviction_count << "\n";
-            out << "Writebacks: " << stats.writeback_count << "\n";
-            out << "Bus Invalidations: " << stats.invalidations << "\n";
-            out << "Data Traffic (Bytes): " << stats.data_traffic << "\n";
+            for (const auto& field : CORE_STAT_FIELDS) {
+                estimate.cores[i].cache.stats.*field.second += point.cluster_size * simulator.cores[i].cache.stats.*field.second;
+            }
         }
-        out << "\nOverall Bus Summary:\n";
-        out << "Total Bus Transactions: " << total_bus_transactions << "\n";
-        out << "Total Bus Traffic (Bytes): " << total_bus_traffic << "\n";
-        out << "Maximum Execution Time: " << get_max_execution_time() << "\n"; // Added Max_Execution_Time
+        estimate.atomics = estimate.atomics || simulator.atomics;
+        estimate.total_bus_transactions += point.cluster_size * simulator.total_bus_transactions;
+        estimate.total_bus_traffic += point.cluster_size * simulator.total_bus_traffic;
+        uint64_t misses = 0;
+        for (const auto& core : simulator.cores) misses += core.cache.stats.miss_count;
+        representative_results.push_back({simulator.get_max_execution_time(), misses});
     }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+    auto print_simpoints = [&](std::ostream& out, bool csv_format) {
+        double simulated_share = total_accesses > 0 ? (double)simulated_accesses / total_accesses * 100 : 0;
+        if (csv_format) {
+            out << "\nSimPoint_Interval,Cluster_Size,Weight,Max_Execution_Time,Misses\n";
+            for (size_t r = 0; r < set.points.size(); r++) {
+                out << set.points[r].interval << "," << set.points[r].cluster_size << ","
+                    << std::fixed << std::setprecision(4) << (double)set.points[r].cluster_size / set.intervals << ","
+                    << representative_results[r].first << "," << representative_results[r].second << "\n";
+            }
+            out << "\nEstimated_Field,Core0,Core1,Core2,Core3\n";
+            for (const auto& field : CORE_STAT_FIELDS) {
+                out << field.first;
+                for (int i = 0; i < 4; i++) out << "," << estimate.cores[i].cache.stats.*field.second;
+                out << "\n";
+            }
+            out << "\nSimPoint,Value\n";
+            out << "Interval_Length," << set.interval_length << "\n";
+            out << "Intervals," << set.intervals << "\n";
+            out << "Representatives," << set.points.size() << "\n";
+            out << "Warmup_Intervals," << warmup << "\n";
+            out << "Accesses_Simulated," << simulated_accesses << "\n";
+            out << "Accesses_Total," << total_accesses << "\n";
+            out << "Simulated_Percent," << std::fixed << std::setprecision(2) << simulated_share << "\n";
+        } else {
+            out << "\nSimPoint Estimate: " << set.points.size() << " representatives of " << set.intervals
+                << " intervals of " << set.interval_length << " accesses per core , " << warmup << " warm up intervals\n";
+            for (size_t r = 0; r < set.points.size(); r++) {
+                out << "Interval " << set.points[r].interval << ": weight " << std::fixed << std::setprecision(4)
+                    << (double)set.points[r].cluster_size / set.intervals << ", "
+                    << representative_results[r].first << " cycles, " << representative_results[r].second << " misses\n";
+            }
+            out << "Accesses Simulated: " << simulated_accesses << " of " << total_accesses << " ("
+                << std::fixed << std::setprecision(2) << simulated_share << "%) in " << std::setprecision(3) << seconds << " s\n";
+        }
+    };
+
+    if (!outfilename.empty()) {
+        std::ofstream outfile(outfilename);
+        if (!outfile) {
+            std::cerr << "Error: Cannot open output file " << outfilename << "\n";
+            return 1;
+        }
+        estimate.print_stats(outfile, true);
+        print_simpoints(outfile, true);
+    }
+    estimate.print_stats(std::cout, false);
+    print_simpoints(std::cout, false);
+    return 0;
 }
-};
 
 // this is the main function which takes the command line arguments and sets up the simulator and runs it
 int main(int argc, char* argv[]) {
@@ -638,9 +530,51 @@ int main(int argc, char* argv[]) {
     uint32_t s = 0, E = 0, b = 0;
     std::string outfilename;
     bool help_flag = false;
+    std::string batch_directory;
+    size_t batch_threads = std::thread::hardware_concurrency();
+    std::string simpoint_file;
+    uint64_t warmup_intervals = 1;
+    SimOptions options;
+
+    // the long options only switch on the extra models and reports , the cache itself is still set up by -s -E -b
+    enum { OPT_CLASSIFY_MISSES = 256, OPT_VICTIM_CACHE, OPT_INDEX_FUNCTION, OPT_PADDR_BITS,
+           OPT_SET_HEATMAP, OPT_INTERVAL, OPT_TIMESERIES, OPT_VERIFY, OPT_FILTERED,
+           OPT_TLB, OPT_PAGE_SIZE, OPT_SNOOP_FILTER, OPT_BATCH, OPT_JOBS, OPT_PROFILE, OPT_L2,
+           OPT_SECTORS, OPT_PROTOCOL, OPT_LOCK_LATENCY, OPT_NUMA,
+           OPT_NUMA_HOME, OPT_SIMPOINTS, OPT_WARMUP, OPT_WRITE_POLICY, OPT_NO_WRITE_ALLOCATE,
+           OPT_WRITE_COMBINING };
+    static const struct option long_options[] = {
+        {"classify-misses", no_argument, nullptr, OPT_CLASSIFY_MISSES},
+        {"victim-cache", required_argument, nullptr, OPT_VICTIM_CACHE},
+        {"index-function", required_argument, nullptr, OPT_INDEX_FUNCTION},
+        {"paddr-bits", required_argument, nullptr, OPT_PADDR_BITS},
+        {"set-heatmap", required_argument, nullptr, OPT_SET_HEATMAP},
+        {"interval", required_argument, nullptr, OPT_INTERVAL},
+        {"timeseries", required_argument, nullptr, OPT_TIMESERIES},
+        {"verify", required_argument, nullptr, OPT_VERIFY},
+        {"filtered", no_argument, nullptr, OPT_FILTERED},
+        {"tlb", required_argument, nullptr, OPT_TLB},
+        {"page-size", required_argument, nullptr, OPT_PAGE_SIZE},
+        {"snoop-filter", no_argument, nullptr, OPT_SNOOP_FILTER},
+        {"batch", required_argument, nullptr, OPT_BATCH},
+        {"jobs", required_argument, nullptr, OPT_JOBS},
+        {"profile", no_argument, nullptr, OPT_PROFILE},
+        {"l2", required_argument, nullptr, OPT_L2},
+        {"sectors", required_argument, nullptr, OPT_SECTORS},
+        {"protocol", required_argument, nullptr, OPT_PROTOCOL},
+        {"lock-latency", required_argument, nullptr, OPT_LOCK_LATENCY},
+        {"numa", required_argument, nullptr, OPT_NUMA},
+        {"numa-home", required_argument, nullptr, OPT_NUMA_HOME},
+        {"simpoints", required_argument, nullptr, OPT_SIMPOINTS},
+        {"warmup", required_argument, nullptr, OPT_WARMUP},
+        {"write-policy", required_argument, nullptr, OPT_WRITE_POLICY},
+        {"no-write-allocate", no_argument, nullptr, OPT_NO_WRITE_ALLOCATE},
+        {"write-combining", required_argument, nullptr, OPT_WRITE_COMBINING},
+        {nullptr, 0, nullptr, 0}
+    };
 
     int opt;
-    while ((opt = getopt(argc, argv, "ht:s:E:b:o:")) != -1) {
+    while ((opt = getopt_long(argc, argv, "ht:s:E:b:o:", long_options, nullptr)) != -1) {
         switch (opt) {
             case 'h':
                 help_flag = true;
@@ -675,6 +609,177 @@ int main(int argc, char* argv[]) {
             case 'o':
                 outfilename = optarg;
                 break;
+            case OPT_CLASSIFY_MISSES:
+                options.classify_misses = true;
+                break;
+            case OPT_VICTIM_CACHE:
+                try {
+                    options.victim_entries = std::stoul(optarg);
+                } catch (...) {
+                    std::cerr << "Error: Invalid value for --victim-cache\n";
+                    return 1;
+                }
+                break;
+            case OPT_PADDR_BITS:
+                try {
+                    options.paddr_bits = std::stoul(optarg);
+                } catch (...) {
+                    std::cerr << "Error: Invalid value for --paddr-bits\n";
+                    return 1;
+                }
+                break;
+            case OPT_SET_HEATMAP:
+                options.set_heatmap_file = optarg;
+                break;
+            case OPT_INTERVAL:
+                try {
+                    options.interval_cycles = std::stoull(optarg);
+                } catch (...) {
+                    std::cerr << "Error: Invalid value for --interval\n";
+                    return 1;
+                }
+                break;
+            case OPT_TIMESERIES:
+                options.timeseries_file = optarg;
+                break;
+            case OPT_VERIFY:
+                try {
+                    options.verify_checkpoint = std::stoull(optarg);
+                } catch (...) {
+                    std::cerr << "Error: Invalid value for --verify\n";
+                    return 1;
+                }
+                break;
+            case OPT_FILTERED:
+                options.filtered_traces = true;
+                break;
+            case OPT_L2:
+                if (!parse_l2(optarg, options.l2)) {
+                    std::cerr << "Error: Invalid value for --l2\n";
+                    return 1;
+                }
+                break;
+            case OPT_PROTOCOL: {
+                std::string protocol = optarg;
+                if (protocol == "mesi") options.protocol = CoherenceProtocol::MESI;
+                else if (protocol == "dragon") options.protocol = CoherenceProtocol::DRAGON;
+                else if (protocol == "firefly") options.protocol = CoherenceProtocol::FIREFLY;
+                else {
+                    std::cerr << "Error: Invalid value for --protocol\n";
+                    return 1;
+                }
+                break;
+            }
+            case OPT_SIMPOINTS:
+                simpoint_file = optarg;
+                break;
+            case OPT_WARMUP:
+                try {
+                    warmup_intervals = std::stoull(optarg);
+                } catch (...) {
+                    std::cerr << "Error: Invalid value for --warmup\n";
+                    return 1;
+                }
+                break;
+            case OPT_NUMA:
+                if (!parse_numa(optarg, options.numa)) {
+                    std::cerr << "Error: Invalid value for --numa\n";
+                    return 1;
+                }
+                break;
+            case OPT_NUMA_HOME: {
+                std::string home = optarg;
+                if (home == "interleave") options.numa.home = HomePolicy::INTERLEAVE;
+                else if (home == "first-touch") options.numa.home = HomePolicy::FIRST_TOUCH;
+                else {
+                    std::cerr << "Error: Invalid value for --numa-home\n";
+                    return 1;
+                }
+                break;
+            }
+            case OPT_LOCK_LATENCY:
+                try {
+                    options.lock_latency = std::stoul(optarg);
+                } catch (...) {
+                    std::cerr << "Error: Invalid value for --lock-latency\n";
+                    return 1;
+                }
+                break;
+            case OPT_SECTORS:
+                try {
+                    options.sectors = std::stoul(optarg);
+                } catch (...) {
+                    std::cerr << "Error: Invalid value for --sectors\n";
+                    return 1;
+                }
+                break;
+            case OPT_PROFILE:
+                options.profile = true;
+                break;
+            case OPT_WRITE_POLICY: {
+                std::string policy = optarg;
+                if (policy == "write-back") options.write_through = false;
+                else if (policy == "write-through") options.write_through = true;
+                else {
+                    std::cerr << "Error: Invalid value for --write-policy\n";
+                    return 1;
+                }
+                break;
+            }
+            case OPT_NO_WRITE_ALLOCATE:
+                options.write_allocate = false;
+                break;
+            case OPT_WRITE_COMBINING:
+                try {
+                    options.combining_entries = std::stoul(optarg);
+                } catch (...) {
+                    std::cerr << "Error: Invalid value for --write-combining\n";
+                    return 1;
+                }
+                break;
+            case OPT_BATCH:
+                batch_directory = optarg;
+                break;
+            case OPT_JOBS:
+                try {
+                    batch_threads = std::stoul(optarg);
+                } catch (...) {
+                    std::cerr << "Error: Invalid value for --jobs\n";
+                    return 1;
+                }
+                break;
+            case OPT_SNOOP_FILTER:
+                options.snoop_filter = true;
+                break;
+            case OPT_TLB:
+                if (!parse_tlb(optarg, options.tlb)) {
+                    std::cerr << "Error: Invalid value for --tlb\n";
+                    return 1;
+                }
+                break;
+            case OPT_PAGE_SIZE: {
+                std::string size = optarg;
+                if (size == "4k") options.tlb.page_bits = 12;
+                else if (size == "2m") options.tlb.page_bits = 21;
+                else if (size == "1g") options.tlb.page_bits = 30;
+                else {
+                    std::cerr << "Error: Invalid value for --page-size\n";
+                    return 1;
+                }
+                break;
+            }
+            case OPT_INDEX_FUNCTION: {
+                std::string mode = optarg;
+                if (mode == "modulo") options.index_mode = IndexMode::MODULO;
+                else if (mode == "xor") options.index_mode = IndexMode::XOR_FOLD;
+                else if (mode == "prime") options.index_mode = IndexMode::PRIME_MODULO;
+                else if (mode == "skewed") options.index_mode = IndexMode::SKEWED;
+                else {
+                    std::cerr << "Error: Invalid value for --index-function\n";
+                    return 1;
+                }
+                break;
+            }
             default:
                 std::cerr << "Usage: " << argv[0] << " -t <trace_prefix> -s <set_bits> -E <associativity> -b <block_bits> [-o <outfilename>] [-h]\n";
                 return 1;
@@ -688,44 +793,130 @@ int main(int argc, char* argv[]) {
                   << "-E <E>: associativity (lines per set)\n"
                   << "-b <b>: number of block bits (block size = 2^b)\n"
                   << "-o <outfilename>: log output to file\n"
-                  << "-h: print this help message\n";
+                  << "-h: print this help message\n"
+                  << "--classify-misses: split misses into compulsory, capacity, conflict and coherence\n"
+                  << "--victim-cache <N>: add an N entry fully associative victim cache to every core\n"
+                  << "--index-function <f>: set index function, one of modulo, xor, prime, skewed\n"
+                  << "--paddr-bits <P>: physical address bits kept from trace addresses (default 48, at most 64)\n"
+                  << "--set-heatmap <file>: write per core, per set accesses, misses and evictions to file\n"
+                  << "--interval <N>: sample bus utilization, queue depth, miss rate and idle cycles every N cycles\n"
+                  << "--timeseries <file>: where the interval samples go (csv, or binary if it ends in .bin)\n"
+                  << "--verify <N>: run the generic engine in lockstep and compare cache contents every N cycles\n"
+                  << "--filtered: replay the <tracefile>_procN.ftrace files written by trace_filter for the same cache\n"
+                  << "--tlb <E1>:<W1>,<E2>:<W2>: add L1 and L2 TLBs with E entries and W ways per core , misses walk the page tables\n"
+                  << "--page-size <4k|2m|1g>: page size used by the TLBs (default 4k)\n"
+                  << "--snoop-filter: skip snooping cores whose presence filter shows they cannot hold the block\n"
+                  << "--batch <dir>: run every application in dir instead of -t , -o names the combined csv (default batch_results.csv)\n"
+                  << "--jobs <N>: threads used by --batch (default one per hardware thread)\n"
+                  << "--profile: report the wall time of each phase , the simulation speed and hot path counters\n"
+                  << "--l2 <s>:<E>:<policy>: add a private L2 with 2^s sets and E ways per core , policy is inclusive, exclusive or nine\n"
+                  << "--sectors <N>: split every block into N sectors with their own state , misses only move one sector\n"
+                  << "--protocol <mesi|dragon|firefly>: coherence protocol , dragon and firefly update the other copies on a write instead of invalidating them\n"
+                  << "--lock-latency <N>: cycles an atomic read modify write (A in a trace) holds its line (default 10)\n"
+                  << "--numa <sockets>:<latency>:<bytes per cycle>: split the cores over 2 or 4 sockets with a bus each , joined by a link\n"
+                  << "--numa-home <interleave|first-touch>: how memory pages are homed on the sockets (default interleave)\n"
+                  << "--simpoints <file>: simulate only the representative intervals written by the simpoint tool and estimate the whole run\n"
+                  << "--warmup <N>: intervals simulated before every representative to warm the caches (default 1)\n"
+                  << "--write-policy <write-back|write-through>: write through posts every write hit to memory and keeps lines clean\n"
+                  << "--no-write-allocate: post write misses to memory instead of bringing their block in\n"
+                  << "--write-combining <N>: merge the posted write misses per block in an N entry buffer (needs --no-write-allocate)\n";
         return 0;
     }
 
-    if (trace_prefix.empty() || s == 0 || E == 0 || b == 0) {
+    if ((trace_prefix.empty() == batch_directory.empty()) || s == 0 || E == 0 || b == 0) {
         std::cerr << "Error: Missing required arguments\n"
                   << "Usage: " << argv[0] << " -t <trace_prefix> -s <set_bits> -E <associativity> -b <block_bits> [-o <outfilename>] [-h]\n";
         return 1;
     }
 
-    std::vector<std::string> trace_files = {
-        trace_prefix + "_proc0.trace",
-        trace_prefix + "_proc1.trace",
-        trace_prefix + "_proc2.trace",
-        trace_prefix + "_proc3.trace"
-    };
+    if (options.interval_cycles > 0 && options.timeseries_file.empty()) {
+        std::cerr << "Error: --interval needs --timeseries <file>\n";
+        return 1;
+    }
 
-    for (const auto& file : trace_files) {
-        std::ifstream f(file);
-        if (!f.good()) {
-            std::cerr << "Error: Trace file " << file << " does not exist or cannot be opened\n";
+    if (options.paddr_bits > 64 || options.paddr_bits <= s + b) {
+        std::cerr << "Error: --paddr-bits must be more than s + b and at most 64\n";
+        return 1;
+    }
+    // both would catch the lines the L1 evicts
+    if (options.l2.enabled() && options.victim_entries > 0) {
+        std::cerr << "Error: --l2 and --victim-cache cannot be used together\n";
+        return 1;
+    }
+    // sectors move through the bus on their own , the victim cache and the L2 only know whole blocks
+    if (options.sectors != 1) {
+        if (options.sectors != 2 && options.sectors != 4 && options.sectors != 8 && options.sectors != 16) {
+            std::cerr << "Error: --sectors must be 2, 4, 8 or 16\n";
+            return 1;
+        }
+        if ((1u << b) / options.sectors < 4) {
+            std::cerr << "Error: sectors must be at least 4 bytes , use fewer --sectors or a larger block\n";
             return 1;
         }
+        if (options.victim_entries > 0 || options.l2.enabled()) {
+            std::cerr << "Error: --sectors cannot be used with --victim-cache or --l2\n";
+            return 1;
+        }
+    }
+    // the update protocols keep whole blocks in a single level
+    if (options.protocol != CoherenceProtocol::MESI && (options.sectors > 1 || options.l2.enabled())) {
+        std::cerr << "Error: --protocol " << protocol_name(options.protocol) << " cannot be used with --sectors or --l2\n";
+        return 1;
+    }
+    // the write policies post words to memory from a single level of whole blocks , and the update protocols have
+    // their own way of writing through
+    if (options.write_through || !options.write_allocate) {
+        if (options.protocol != CoherenceProtocol::MESI || options.sectors > 1 || options.l2.enabled()) {
+            std::cerr << "Error: --write-policy write-through and --no-write-allocate cannot be used with --protocol, --sectors or --l2\n";
+            return 1;
+        }
+    }
+    if (options.combining_entries > 0 && (options.write_allocate || options.combining_entries > 64)) {
+        std::cerr << "Error: --write-combining needs --no-write-allocate and at most 64 entries\n";
+        return 1;
+    }
+    if (options.tlb.enabled() && options.tlb.page_bits + 9 >= options.paddr_bits) {
+        std::cerr << "Error: --page-size is too large for " << options.paddr_bits << " physical address bits\n";
+        return 1;
+    }
+    // a line keeps a 16 bit id for the tag bits above 32 , with more lines than ids they could run out
+    // the L2 lines count too once its tags are wider than 32 bits
+    uint64_t region_lines = options.paddr_bits > 32 + s + b ? (1ull << s) * E + options.victim_entries : 0;
+    if (options.l2.enabled() && options.paddr_bits > 32 + options.l2.set_bits + b) {
+        region_lines += (1ull << options.l2.set_bits) * options.l2.ways;
+    }
+    if (region_lines >= TagRegionTable::NO_REGION) {
+        std::cerr << "Error: too many cache lines for " << options.paddr_bits << " physical address bits , lower --paddr-bits\n";
+        return 1;
     }
 
-    Simulator simulator(s, E, b, trace_files, trace_prefix);
-    simulator.run();
+    if (!simpoint_file.empty()) {
+        if (!batch_directory.empty() || options.filtered_traces || options.verify_checkpoint > 0 ||
+            options.interval_cycles > 0 || !options.set_heatmap_file.empty()) {
+            std::cerr << "Error: --simpoints cannot be used with --batch, --filtered, --verify, --interval or --set-heatmap\n";
+            return 1;
+        }
+        return run_simpoints(s, E, b, trace_prefix, options, simpoint_file, warmup_intervals, outfilename);
+    }
 
-    if (!outfilename.empty()) {
-        std::ofstream outfile(outfilename);
-        if (!outfile) {
-            std::cerr << "Error: Cannot open output file " << outfilename << "\n";
+    if (!batch_directory.empty()) {
+        if (!options.set_heatmap_file.empty() || !options.timeseries_file.empty()) {
+            std::cerr << "Error: --set-heatmap and --timeseries write one file per run and cannot be used with --batch\n";
             return 1;
         }
-        simulator.print_stats(outfile, true);
-        outfile.close();
+        return run_batch(batch_directory, s, E, b, options, outfilename.empty() ? "batch_results.csv" : outfilename,
+                         batch_threads);
     }
-    simulator.print_stats(std::cout, false);
 
-    return 0;
-}
\ No newline at end of file
+    std::vector<std::string> trace_files = pick_trace_files(trace_prefix, s, E, b, options);
+
+    for (const auto& file : trace_files) {
+        std::ifstream f(file);
+        if (!f.good()) {
+            std::cerr << "Error: Trace file " << file << " does not exist or cannot be opened\n";
+            return 1;
+        }
+    }
+
+    return run_simulation<Cache<>>(s, E, b, trace_files, trace_prefix, options, outfilename, &std::cout, nullptr);
+}
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "cachesim.hpp"
+#include <getopt.h>
+
+// this rewrites the four traces of an application into <prefix>_procN.ftrace files for L1simulate --filtered
+// every core's trace is run through a single core LRU model of its cache , and runs of accesses that hit there on
+// blocks no other core ever touches are written as one H line , everything else is copied as it is
+// such a hit is also a hit in the multicore run : no other core can invalidate the block , and an LRU set only ever
+// holds more of the recent blocks when coherence frees some of its lines , never fewer
+
+// the trace letter of an access , so atomics are written back out as they came in
+char trace_op(const Access& access) {
+    switch (access.kind) {
+        case AccessKind::RMW: return 'A';
+        case AccessKind::LOAD_RESERVED: return 'L';
+        case AccessKind::STORE_CONDITIONAL: return 'S';
+        default: return access.is_write ? 'W' : 'R';
+    }
+}
+
+// writes one run of model hits , short runs are not worth an H line and are copied as plain accesses
+void write_run(std::ostream& out, const std::vector<Access>& run, uint32_t b, size_t min_run, uint64_t& folded) {
+    if (run.size() < min_run) {
+        for (const auto& access : run) out << (access.is_write ? 'W' : 'R') << " 0x" << std::hex << access.address << std::dec << "\n";
+        return;
+    }
+    HitSegment segment;
+    std::unordered_map<uint64_t, size_t> slot;
+    for (uint32_t pos = 0; pos < run.size(); pos++) {
+        const Access& access = run[pos];
+        (access.is_write ? segment.writes : segment.reads)++;
+        auto [it, added] = slot.emplace(access.address >> b, segment.blocks.size());
+        if (added) segment.blocks.push_back({access.address, pos, access.is_write});
+        HitSegment::Block& block = segment.blocks[it->second];
+        block.last_position = pos;
+        block.written = block.written || access.is_write;
+    }
+    out << "H " << segment.reads << " " << segment.writes << " " << segment.blocks.size();
+    for (const auto& block : segment.blocks) {
+        out << " " << std::hex << block.address << std::dec << " " << block.last_position << " " << block.written;
+    }
+    out << "\n";
+    folded += run.size();
+}
+
+int main(int argc, char* argv[]) {
+    std::string trace_prefix;
+    uint32_t s = 0, E = 0, b = 0;
+    uint32_t paddr_bits = 48;
+    size_t min_run = 8;
+    IndexMode index_mode = IndexMode::MODULO;
+
+    enum { OPT_INDEX_FUNCTION = 256, OPT_PADDR_BITS };
+    static const struct option long_options[] = {
+        {"index-function", required_argument, nullptr, OPT_INDEX_FUNCTION},
+        {"paddr-bits", required_argument, nullptr, OPT_PADDR_BITS},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "ht:s:E:b:m:", long_options, nullptr)) != -1) {
+        try {
+            switch (opt) {
+                case 't': trace_prefix = optarg; break;
+                case 's': s = std::stoul(optarg); break;
+                case 'E': E = std::stoul(optarg); break;
+                case 'b': b = std::stoul(optarg); break;
+                case 'm': min_run = std::stoul(optarg); break;
+                case OPT_PADDR_BITS: paddr_bits = std::stoul(optarg); break;
+                case OPT_INDEX_FUNCTION: {
+                    std::string mode = optarg;
+                    if (mode == "modulo") index_mode = IndexMode::MODULO;
+                    else if (mode == "xor") index_mode = IndexMode::XOR_FOLD;
+                    else if (mode == "prime") index_mode = IndexMode::PRIME_MODULO;
+                    else if (mode == "skewed") index_mode = IndexMode::SKEWED;
+                    else {
+                        std::cerr << "Error: Invalid value for --index-function\n";
+                        return 1;
+                    }
+                    break;
+                }
+                default:
+                    std::cout << "Usage: " << argv[0] << " -t <trace_prefix> -s <set_bits> -E <associativity> -b <block_bits> [-m <min_run>]\n"
+                              << "       [--index-function <modulo|xor|prime>] [--paddr-bits <P>]\n"
+                              << "writes <trace_prefix>_procN.ftrace for L1simulate --filtered with the same cache options\n";
+                    return opt == 'h' ? 0 : 1;
+            }
+        } catch (...) {
+            std::cerr << "Error: Invalid value for option " << static_cast<char>(opt) << "\n";
+            return 1;
+        }
+    }
+
+    if (trace_prefix.empty() || s == 0 || E == 0 || b == 0) {
+        std::cerr << "Error: Missing required arguments\n";
+        return 1;
+    }
+    // in a skewed cache every way has its own set , so a hit in the model says nothing about the multicore run
+    if (index_mode == IndexMode::SKEWED) {
+        std::cerr << "Error: skewed indexing cannot be filtered\n";
+        return 1;
+    }
+    if (paddr_bits > 64 || paddr_bits <= s + b) {
+        std::cerr << "Error: --paddr-bits must be more than s + b and at most 64\n";
+        return 1;
+    }
+    // same limit as L1simulate , the 16 bit tag region ids of the model could run out
+    if (paddr_bits > 32 + s + b && (1ull << s) * E >= TagRegionTable::NO_REGION) {
+        std::cerr << "Error: too many cache lines for " << paddr_bits << " physical address bits , lower --paddr-bits\n";
+        return 1;
+    }
+    if (min_run == 0) min_run = 1;
+
+    std::vector<Access> traces[4];
+    for (int i = 0; i < 4; i++) {
+        std::string filename = trace_prefix + "_proc" + std::to_string(i) + ".trace";
+        if (!read_trace_accesses(filename, paddr_bits, traces[i])) {
+            std::cerr << "Error: Trace file " << filename << " does not exist or cannot be opened\n";
+            return 1;
+        }
+    }
+
+    // which cores touch every block , only blocks of a single core can be folded
+    // blocks with atomics are never folded , a failed store conditional or a lock changes what happens next
+    std::unordered_map<uint64_t, uint8_t> block_cores;
+    for (int i = 0; i < 4; i++) {
+        for (const auto& access : traces[i]) {
+            block_cores[access.address >> b] |= access.kind == AccessKind::PLAIN ? 1 << i : 0xF;
+        }
+    }
+
+    for (int i = 0; i < 4; i++) {
+        std::string filename = trace_prefix + "_proc" + std::to_string(i) + ".ftrace";
+        std::ofstream out(filename);
+        if (!out) {
+            std::cerr << "Error: Cannot open output file " << filename << "\n";
+            return 1;
+        }
+        out << "# filtered " << s << " " << E << " " << b << " " << index_mode_name(index_mode) << " " << paddr_bits << "\n";
+
+        Cache<> model(i, s, E, b);
+        model.index_mode = index_mode;
+        uint64_t traffic = 0;
+        uint64_t folded = 0;
+        std::vector<Access> run;
+        for (const auto& access : traces[i]) {
+            BusTransaction trans;
+            bool hit = model.access(access.address, access.is_write, trans, true).first;
+            if (!hit && trans.operation != BusOperation::INVALIDATE) {
+                model.install_block(access.address, {}, access.is_write ? MESIState::MODIFIED : MESIState::EXCLUSIVE, &traffic);
+            }
+            if (hit && block_cores[access.address >> b] == (1 << i)) {
+                run.push_back(access);
+                continue;
+            }
+            write_run(out, run, b, min_run, folded);
+            run.clear();
+            out << trace_op(access) << " 0x" << std::hex << access.address << std::dec << "\n";
+        }
+        write_run(out, run, b, min_run, folded);
+
+        std::cout << filename << ": " << folded << " of " << traces[i].size() << " accesses folded into hit runs\n";
+    }
+    return 0;
+}
@@ -0,0 +1,42 @@
+// --------------------- Header Files ------------------------------------------
+#include "./pipeline.hpp"
+
+// Runs the program with the branch stage named on the command line, "if" or "id"
+template <ForwardingPolicy Forwarding>
+int runWithBranch(const std::string &fileName, int cycleCount, const std::string &branch, const std::string &suffix)
+{
+    if (branch == "if")
+        return runPipelined<Forwarding, RESOLVE_IN_IF>(fileName, cycleCount, suffix);
+    if (branch == "id")
+        return runPipelined<Forwarding, RESOLVE_IN_ID>(fileName, cycleCount, suffix);
+    std::cerr << "Unknown branch stage " << branch << ", expected if or id\n";
+    return 1;
+}
+
+// ---------------------------- Main ----------------------------
+// Any configuration of the pipeline engine, picked at run time
+// Every combination is instantiated here, so building this binary compiles all of them
+int main(int argc, char *argv[])
+{
+    if (argc != 5)
+    {
+        std::cerr << "Required arguments: file_name cycle_count forwarding branch_stage\n"
+                  << "./pipeline <file name> <cycle count> <none|full|exmem> <if|id>\n";
+        return 0;
+    }
+
+    std::string fileName = argv[1];
+    int cycleCount = std::stoi(argv[2]);
+    std::string forwarding = argv[3];
+    std::string branch = argv[4];
+    std::string suffix = "_" + forwarding + "_" + branch + "_out.txt";
+
+    if (forwarding == "none")
+        return runWithBranch<NO_FORWARDING>(fileName, cycleCount, branch, suffix);
+    if (forwarding == "full")
+        return runWithBranch<FULL_FORWARDING>(fileName, cycleCount, branch, suffix);
+    if (forwarding == "exmem")
+        return runWithBranch<EX_MEM_FORWARDING>(fileName, cycleCount, branch, suffix);
+    std::cerr << "Unknown forwarding policy " << forwarding << ", expected none, full or exmem\n";
+    return 1;
+}
@@ -0,0 +1,838 @@
+#ifndef __RISCV_PIPELINE_HPP__
+ #define __RISCV_PIPELINE_HPP__
+
+// --------------------- Header Files ------------------------------------------
+#include "./processor.hpp"
+#include <string>
+#include <functional>
+#include <filesystem>
+#include <fstream>
+
+// --------------------- Pipeline Configuration --------------------------------
+// Which latches may feed a value back to an instruction instead of stalling it
+enum ForwardingPolicy
+{
+	NO_FORWARDING,     // Every hazard stalls until the producer has written back
+	FULL_FORWARDING,   // Bypass from the EX/MEM and MEM/WB latches
+	EX_MEM_FORWARDING  // Bypass from the EX/MEM latch only, a producer in MEM/WB stalls
+};
+
+// The stage in which a branch waits for its operands
+// Branches are never taken (see the known issues), so this only moves the branch hazards
+enum BranchResolution
+{
+	RESOLVE_IN_IF, // Checked as soon as it is fetched, against the ID, EX and MEM stages
+	RESOLVE_IN_ID  // Checked in ID like any other instruction reading two registers
+};
+
+// --------------------- Structures of Latches ---------------------------------
+// The latch after the IF stage
+struct IF_ID
+{
+	Instruction inst;
+	int PCnext=0;
+	bool nop_sw= false ;
+	bool nop ;
+};
+
+// The latch after the ID stage
+struct ID_EX
+{
+	Instruction inst;
+	int PCnext =0;
+	int store_address;
+
+	int rd = NO_REGISTER;
+	int rs = NO_REGISTER;
+	int ReadData1;
+	int rt = NO_REGISTER;
+	int ReadData2;
+
+
+	bool MemRead;
+	bool MemWrite;
+	bool writeRegister;
+	int type;
+
+	bool nop;
+
+	// Registers this stage will write, and load from memory, for the hazard scoreboard
+	unsigned long long writes() const { return writeRegister ? registerBit(rd) : 0; }
+	unsigned long long loads() const { return MemRead ? registerBit(rd) : 0; }
+
+};
+
+// The latch after the EX stage
+struct EX_MEM
+{
+	Instruction inst;
+	int PCnext;
+	int store_address;
+
+	int ALUresult;
+	int rd = NO_REGISTER;
+	int rt = NO_REGISTER;
+	// std::string return_address;
+
+	bool MemRead;
+	bool MemWrite;
+	bool writeRegister;
+
+	bool nop;
+
+	// Registers this stage will write, and load from memory, for the hazard scoreboard
+	unsigned long long writes() const { return writeRegister ? registerBit(rd) : 0; }
+	unsigned long long loads() const { return MemRead ? registerBit(rd) : 0; }
+};
+
+// The latch after the MEM stage
+struct MEM_WB
+{
+	Instruction inst;
+	int PCnext;
+	int store_address;
+
+	int rd = NO_REGISTER;
+	int ALUresult;
+
+	bool writeRegister;
+	bool MemRead;
+
+	bool nop;
+
+	// Registers this stage will write, and load from memory, for the hazard scoreboard
+	unsigned long long writes() const { return writeRegister ? registerBit(rd) : 0; }
+	unsigned long long loads() const { return MemRead ? registerBit(rd) : 0; }
+};
+
+// The state of the processor
+struct state
+{
+	bool to_fetch = true; // for the branches and jumps
+	IF_ID if_id;
+	ID_EX id_ex;
+	EX_MEM ex_mem;
+	MEM_WB mem_wb;
+};
+enum HazardCheckType {
+    DEFAULT_STALL,    // Checks EX and MEM stages (original check_stall)
+    EX_STALL,         // Checks only MEM stage (original check_stall_ex)
+    LW_SW_STALL,      // Checks EX and MEM stages for rt only (original check_stall_lw_sw)
+    BRANCH_STALL      // Checks ID, EX, and MEM stages (original check_stall_bq)
+};
+
+inline bool check_stall(int rs, int rt, state& s, HazardCheckType type = DEFAULT_STALL) {
+    // Registers still to be written by the later stages
+    unsigned long long pending;
+    switch (type) {
+        case EX_STALL:
+            // Only check MEM stage
+            pending = s.mem_wb.writes();
+            break;
+
+        case BRANCH_STALL:
+            // Check ID, EX, and MEM stages
+            pending = s.id_ex.writes() | s.ex_mem.writes() | s.mem_wb.writes();
+            break;
+
+        case LW_SW_STALL:
+        case DEFAULT_STALL:
+        default:
+            // Check EX and MEM stages
+            pending = s.ex_mem.writes() | s.mem_wb.writes();
+            break;
+    }
+
+    // For LW_SW_STALL, we only check rt (as in original check_stall_lw_sw), for EX_STALL only rs
+    unsigned long long sources;
+    if (type == LW_SW_STALL)
+        sources = registerBit(rt);
+    else if (type == EX_STALL)
+        sources = registerBit(rs);
+    else
+        sources = registerBit(rs) | registerBit(rt);
+
+    return (pending & sources & REGISTER_BITS) != 0;
+}
+
+inline bool is_branch(Opcode opcode)
+{
+	return opcode == OP_BEQ || opcode == OP_BNE || opcode == OP_BGE || opcode == OP_BGT;
+}
+
+// Checks if bypassing is possible and returns the bypassed value
+// {true, 1} means the value is not ready and the instruction stalls, {true, 0} that no later stage writes r
+template <ForwardingPolicy Forwarding>
+std::pair<bool, int> from_mem_wb(state &s)
+{
+	if (Forwarding == FULL_FORWARDING)
+		return std::make_pair(false, s.mem_wb.ALUresult);
+	return std::make_pair(true, 1);
+}
+
+template <ForwardingPolicy Forwarding>
+std::pair<bool, int> from_ex_mem(state &s)
+{
+	if (Forwarding != NO_FORWARDING)
+		return std::make_pair(false, s.ex_mem.ALUresult);
+	return std::make_pair(true, 1);
+}
+
+template <ForwardingPolicy Forwarding>
+std::pair<bool, int> bypass(int r, state &s)
+{
+	if (registerBit(r) & s.ex_mem.loads())
+		return std::make_pair(true, 1);
+	else if (registerBit(r) & s.mem_wb.loads())
+		return from_mem_wb<Forwarding>(s);
+	else if (registerBit(r) & s.ex_mem.writes())
+		return from_ex_mem<Forwarding>(s);
+	else if (registerBit(r) & s.mem_wb.writes())
+		return from_mem_wb<Forwarding>(s);
+	else
+		return std::make_pair(true, 0);
+}
+
+template <ForwardingPolicy Forwarding>
+std::pair<bool, int> bypass_bq(int r, state &s)
+{
+	if (registerBit(r) & s.id_ex.writes())
+		return std::make_pair(true,1);
+	else if (registerBit(r) & s.ex_mem.loads())
+		return std::make_pair(true, 1);
+	else if (registerBit(r) & s.ex_mem.writes())
+		return from_ex_mem<Forwarding>(s);
+	else if (registerBit(r) & s.mem_wb.loads())
+		return from_mem_wb<Forwarding>(s);
+	else if (registerBit(r) & s.mem_wb.writes())
+		return from_mem_wb<Forwarding>(s);
+	else
+		return std::make_pair(true, 0);
+}
+
+template <ForwardingPolicy Forwarding>
+std::pair<bool, int> bypass_ex(int r, state &s)
+{
+	if (registerBit(r) & s.mem_wb.writes())
+		return from_mem_wb<Forwarding>(s);
+	else
+		return std::make_pair(true, 0);
+}
+
+// Holds the instruction in ID for another cycle, IF fetches it again
+inline void stall_id(struct RISCV_Architecture *arch, state &s)
+{
+	s.id_ex.nop = true;
+	arch->PCcurr = s.id_ex.PCnext;
+	arch->PCnext = arch->PCcurr;
+}
+
+// Stalls the instruction in ID or bypasses its two register operands into ReadData1 and ReadData2
+template <ForwardingPolicy Forwarding>
+void resolve_operands(int first, int second, struct RISCV_Architecture *arch, state &s)
+{
+	if (!check_stall(first, second, s, DEFAULT_STALL))
+		return;
+
+	std::pair<bool, int> a = bypass<Forwarding>(second, s);
+	if (a.first && a.second != 0)
+	{
+		stall_id(arch, s);
+	}
+	else if (!a.first)
+	{
+		// Bypassing
+		s.id_ex.ReadData2 = a.second;
+	}
+
+	std::pair<bool, int> b = bypass<Forwarding>(first, s);
+	if (b.first && b.second != 0)
+	{
+		stall_id(arch, s);
+	}
+	else if (!b.first)
+	{
+		// Bypassing
+		s.id_ex.ReadData1 = b.second;
+	}
+}
+
+// --------------------- Fetch Stage ------------------------------------------
+template <ForwardingPolicy Forwarding, BranchResolution Branch>
+int IF(struct RISCV_Architecture *arch, state &s)
+{
+	// If can be fetched
+	if (s.to_fetch)
+	{
+		// PC is less than max size
+		if (arch->PCcurr < arch->commands.size())
+		{
+			s.if_id.inst = arch->instructions[arch->PCcurr];
+			// std::cout << arch->mnemonic(s.if_id.inst) << std::endl;
+			s.if_id.PCnext = arch->PCcurr; // Points to itself
+			arch->PCnext = arch->PCcurr + 1;
+			s.if_id.nop = false;
+		}
+		else
+		{
+			s.if_id.nop = true;
+		}
+	}
+	else
+	{
+		s.if_id.nop = true;
+	}
+
+	// A branch waits here until its operands are ready, IF fetches it again
+	if (Branch == RESOLVE_IN_IF && is_branch(s.if_id.inst.opcode) && check_stall(s.if_id.inst.rd,s.if_id.inst.rs, s,BRANCH_STALL))
+	{
+		bool stall = Forwarding == NO_FORWARDING;
+		if (!stall)
+		{
+			std::pair<bool, int> a = bypass_bq<Forwarding>(s.id_ex.rd, s);
+			std::pair<bool, int> b = bypass<Forwarding>(s.id_ex.rs, s);
+			stall = (a.first && a.second != 0) || (b.first && b.second != 0);
+		}
+		if (stall)
+		{
+			arch->PCcurr = s.if_id.PCnext;
+			arch->PCnext = arch->PCcurr;
+			// std::cout << "Stalled" << std::endl;
+		}
+	}
+	return 0;
+}
+
+// --------------------- Decode Stage -----------------------------------------
+template <ForwardingPolicy Forwarding, BranchResolution Branch>
+int ID(struct RISCV_Architecture *arch, state &s)
+{
+	// If the previous stage is nop, then this stage is nop
+	if (s.if_id.nop)
+	{
+		s.id_ex.inst = s.if_id.inst;
+		s.id_ex.PCnext = s.if_id.PCnext; // Points to itself
+		s.id_ex.nop = true;
+		s.id_ex.rd = NO_REGISTER;
+		s.id_ex.rs = NO_REGISTER;
+		s.id_ex.rt = NO_REGISTER;
+
+		s.if_id.inst = Instruction();
+
+		return 0;
+	}
+	if((s.ex_mem.nop) && (s.ex_mem.inst.opcode == OP_SW||s.ex_mem.inst.opcode == OP_SB) && check_stall(s.ex_mem.rd,s.ex_mem.rt, s,EX_STALL)){
+		// update nothing
+		s.id_ex.inst = s.ex_mem.inst; // Copying the command
+		s.id_ex.PCnext =s.ex_mem.PCnext;
+	}
+	else {
+		s.id_ex.inst = s.if_id.inst; // Copying the command
+		s.id_ex.PCnext = s.if_id.PCnext;   // Points to itself
+
+	}
+	// Setting the control signals and reading the data from the registers
+	s.id_ex.rd = s.id_ex.inst.rd;
+	s.id_ex.rs = s.id_ex.inst.rs;
+	s.id_ex.rt = s.id_ex.inst.rt;
+
+	s.id_ex.nop = false;
+	switch (s.id_ex.inst.opcode) {
+    case OP_ADD:
+    case OP_SUB:
+    case OP_MUL:
+    case OP_SLT:
+    case OP_SLL:
+        s.id_ex.ReadData1 = arch->readRegister(s.id_ex.rs);
+        s.id_ex.ReadData2 = arch->readRegister(s.id_ex.rt);
+        s.id_ex.type = 0;
+        break;
+
+    case OP_ADDI:
+    case OP_SLLI:
+        s.id_ex.ReadData1 = arch->readRegister(s.id_ex.rs);
+        s.id_ex.ReadData2 = s.id_ex.inst.imm;
+        s.id_ex.type = 1;
+        break;
+
+    case OP_LW:
+    case OP_SW:
+    case OP_LB:
+    case OP_SB:
+        // The base register of offset(base) was separated at decode time
+        s.id_ex.ReadData1 = arch->readRegister(s.id_ex.rd); // Value to store/update
+        s.id_ex.ReadData2 = arch->readRegister(s.id_ex.rt) + s.id_ex.inst.imm; // Memory address
+        if (s.id_ex.ReadData2 > arch->MAX >> 2) return 3;
+        s.id_ex.type = 2;
+        break;
+
+    case OP_BEQ:
+    case OP_BNE:
+    case OP_BGE:
+    case OP_BGT:
+        s.id_ex.type = 3;
+        s.id_ex.ReadData1 = arch->readRegister(s.id_ex.rd);
+        s.id_ex.ReadData2 = arch->readRegister(s.id_ex.rs);
+        break;
+
+    case OP_JAL:
+        s.id_ex.type = 4;
+        arch->PCcurr = s.id_ex.PCnext + s.id_ex.inst.imm / 4; // Offset is in rs (2nd operand)
+        arch->PCnext = arch->PCcurr;
+        s.to_fetch = false; // Pause fetching
+        break;
+
+    case OP_JALR:
+        s.id_ex.type = 4;
+        arch->PCcurr = s.id_ex.PCnext + (arch->readRegister(s.id_ex.rt) + s.id_ex.inst.imm) / 4;
+        arch->PCnext = arch->PCcurr;
+        s.to_fetch = false; // Pause fetching
+        break;
+
+    default:
+        // Handle unknown opcodes (optional)
+        break;
+}
+
+
+
+	// Setting the control signals200
+	if (s.id_ex.inst.opcode == OP_LW|| s.id_ex.inst.opcode == OP_LB)
+	{
+		s.id_ex.MemRead = 1;
+		s.id_ex.MemWrite = 0;
+		s.id_ex.writeRegister = 1;
+	}
+	else if (s.id_ex.inst.opcode == OP_SW||s.id_ex.inst.opcode == OP_SB)
+	{
+		s.id_ex.MemRead = 0;
+		s.id_ex.MemWrite = 1;
+		s.id_ex.writeRegister = 0;
+	}
+	else if (s.id_ex.type != 3)
+	{
+		s.id_ex.MemRead = 0;
+		s.id_ex.MemWrite = 0;
+		s.id_ex.writeRegister = 1;
+	}
+	else
+	{
+		s.id_ex.MemRead = 0;
+		s.id_ex.MemWrite = 0;
+		s.id_ex.writeRegister = 0;
+	}
+
+	// Stalling Check + Bypassing
+	if ((s.id_ex.inst.opcode == OP_LW || s.id_ex.inst.opcode == OP_SW||s.id_ex.inst.opcode == OP_SB||s.id_ex.inst.opcode == OP_LB) && check_stall(s.id_ex.rd,s.id_ex.rt, s,LW_SW_STALL))
+	{
+		std::pair<bool, int> a = bypass<Forwarding>(s.id_ex.rt, s);
+		if (a.first && a.second != 0)
+		{
+			stall_id(arch, s);
+			if (Forwarding == NO_FORWARDING && (s.id_ex.inst.opcode == OP_SW || s.id_ex.inst.opcode == OP_SB))
+				std::cout << "Stalled" << "\n";
+		}
+		else if (!a.first)
+		{
+			// Bypassing
+			s.id_ex.ReadData2 = (a.second + s.id_ex.inst.imm) / 4;
+		}
+	}
+	else if (is_branch(s.id_ex.inst.opcode))
+	{
+		// Operands are compared like rs and rt of an arithmetic instruction
+		if (Branch == RESOLVE_IN_ID)
+			resolve_operands<Forwarding>(s.id_ex.rd, s.id_ex.rs, arch, s);
+	}
+	else if (s.id_ex.inst.opcode == OP_JAL || s.id_ex.inst.opcode == OP_JALR)
+	{
+		// no register to check
+	}
+	else
+	{
+		resolve_operands<Forwarding>(s.id_ex.rs, s.id_ex.rt, arch, s);
+	}
+	if(s.ex_mem.nop && (s.id_ex.inst.opcode == OP_SB || s.id_ex.inst.opcode == OP_SW) && check_stall(s.id_ex.rd,s.id_ex.rt, s,EX_STALL)){
+		arch->PCcurr = s.if_id.PCnext;
+		arch->PCnext = arch->PCcurr;
+	}
+
+	return 0;
+}
+
+// ---------------------------- Execution Stage -------------------------------
+template <ForwardingPolicy Forwarding>
+int EX(struct RISCV_Architecture *arch, state &s)
+{
+	// std::cout << "EX" << std::endl;
+	if (s.id_ex.nop)
+	{
+		s.ex_mem.inst = s.id_ex.inst;
+		s.ex_mem.PCnext = s.id_ex.PCnext; // Points to itself
+		s.ex_mem.nop = true;
+		s.ex_mem.writeRegister = false;
+		s.ex_mem.MemWrite = false;
+		s.ex_mem.MemRead = false;
+
+		s.id_ex.inst = Instruction();
+		s.id_ex.rd = NO_REGISTER;
+		s.id_ex.rs = NO_REGISTER;
+		s.id_ex.rt = NO_REGISTER;
+
+		return 0;
+	}
+
+
+	if (Forwarding == NO_FORWARDING)
+		std :: cout << arch->mnemonic(s.id_ex.inst) <<  "I was in EX "<< "\n";
+	// Calculating the ALUresult
+	switch (s.id_ex.type) {
+    case 0:  // R-type instructions (add, sub, mul, slt)
+        {
+            switch (s.id_ex.inst.opcode) {
+                case OP_ADD:
+                    s.ex_mem.ALUresult = s.id_ex.ReadData1 + s.id_ex.ReadData2;
+                    break;
+                case OP_SUB:
+                    s.ex_mem.ALUresult = s.id_ex.ReadData1 - s.id_ex.ReadData2;
+                    break;
+                case OP_MUL:
+                    s.ex_mem.ALUresult = s.id_ex.ReadData1 * s.id_ex.ReadData2;
+                    break;
+                case OP_SLT:
+                    s.ex_mem.ALUresult = s.id_ex.ReadData1 < s.id_ex.ReadData2;
+                    break;
+				case OP_SLL:
+                    s.ex_mem.ALUresult = s.id_ex.ReadData1 << s.id_ex.ReadData2;
+                    break;
+                default:
+                    // Handle unknown R-type commands (optional)
+                    break;
+            }
+        }
+        break;
+
+    case 1:  // addi (I-type)
+       {
+
+        switch (s.id_ex.inst.opcode) {
+            case OP_ADDI:
+                s.ex_mem.ALUresult = s.id_ex.ReadData1 + s.id_ex.ReadData2;
+                break;
+            case OP_SLLI:
+                s.ex_mem.ALUresult = s.id_ex.ReadData1 << s.id_ex.ReadData2;
+                break;
+            default:
+                // Handle unknown R-type commands (optional)
+                break;
+        }
+       }
+        break;
+
+    case 2:  // Memory ops (lw, sw, lb, lh, sb)
+        s.ex_mem.ALUresult = s.id_ex.ReadData2;  // Memory address
+        break;
+
+    case 3:  // Branch instructions (beq, bne, bge, bgt)
+        // No ALU action needed here (handled in branch logic)
+        break;
+
+    case 4:  // Jump instructions (jal, jalr)
+        {
+            switch (s.id_ex.inst.opcode) {
+                case OP_JAL:
+                    s.ex_mem.store_address = s.id_ex.PCnext + s.id_ex.inst.imm / 4;
+                    s.ex_mem.ALUresult = s.id_ex.PCnext + 1;  // Return address (PC+4)
+                    break;
+                case OP_JALR:
+                    s.ex_mem.store_address = s.id_ex.PCnext +
+                                             (arch->readRegister(s.id_ex.rt) +
+                                             s.id_ex.inst.imm) / 4;
+                    s.ex_mem.ALUresult = s.id_ex.PCnext + 1;  // Return address (PC+4)
+                    break;
+                default:
+                    // Handle unknown jump commands (optional)
+                    break;
+            }
+        }
+        break;
+
+    default:
+        // Handle unknown instruction types (optional)
+        break;
+	}
+
+	// Setting the control signals
+	s.ex_mem.inst = s.id_ex.inst;
+	s.ex_mem.PCnext = s.id_ex.PCnext;
+
+	s.ex_mem.rt = s.id_ex.rt;
+	s.ex_mem.rd = s.id_ex.rd;
+	s.ex_mem.MemRead = s.id_ex.MemRead;
+	s.ex_mem.MemWrite = s.id_ex.MemWrite;
+	s.ex_mem.writeRegister = s.id_ex.writeRegister;
+
+	s.ex_mem.nop = false;
+	if ((s.ex_mem.inst.opcode == OP_SW||s.ex_mem.inst.opcode == OP_SB)  && check_stall(s.ex_mem.rd,s.ex_mem.rt, s,EX_STALL))
+	{
+		std::pair<bool, int> a = bypass_ex<Forwarding>(s.id_ex.rd, s);
+		if (a.first && a.second != 0)
+		{
+			s.ex_mem.nop = true;
+			if (Forwarding == NO_FORWARDING)
+			{
+				std ::cout << s.ex_mem.PCnext << "\n";
+				std::cout << "Stalled2" << "\n";
+			}
+		}
+		else if (!a.first)
+		{
+			// Bypassing
+			s.id_ex.ReadData2 = (a.second + s.id_ex.inst.imm) / 4;
+		}
+	}
+
+	return 0;
+}
+
+// ---------------------------- Memory stage ----------------------------
+template <ForwardingPolicy Forwarding>
+int MEM(struct RISCV_Architecture *arch, state &s)
+{
+	// If the previous stage is a nop, then this stage is a nop
+	if (s.ex_mem.nop)
+	{
+		s.mem_wb.inst = s.ex_mem.inst;
+		s.mem_wb.PCnext = s.ex_mem.PCnext; // Points to itself
+		s.mem_wb.store_address = s.ex_mem.store_address;
+		s.mem_wb.ALUresult = s.ex_mem.ALUresult;
+		s.mem_wb.nop = true;
+		s.mem_wb.writeRegister = false;
+
+		s.ex_mem.inst = Instruction();
+		s.ex_mem.rd = NO_REGISTER;
+		s.ex_mem.rt = NO_REGISTER;
+        std ::cout << s.mem_wb.PCnext << " I was noped"<< "\n";
+		return 0;
+	}
+
+	if (Forwarding == NO_FORWARDING)
+		std :: cout << arch->mnemonic(s.ex_mem.inst) <<  "I was in MEM "<< "\n";
+	// Uses control signals to determine what to do
+	if (s.ex_mem.MemRead)
+	{
+		if (Forwarding == NO_FORWARDING)
+			std ::cout<< "yes i was here "<<"\n";
+		s.mem_wb.ALUresult = arch->data[s.ex_mem.ALUresult];
+	}
+	else if (s.ex_mem.MemWrite)
+	{
+		if (Forwarding == NO_FORWARDING)
+			std ::cout<< "yes i was not here "<<"\n";
+		int r = s.ex_mem.rd;
+		int address = s.ex_mem.ALUresult;
+		if (Forwarding == NO_FORWARDING)
+			std ::cout<< address <<"\n";
+
+		arch->data[address] = arch->readRegister(r);
+	}
+	else if (is_branch(s.ex_mem.inst.opcode))
+	{
+
+	}
+	else if (s.ex_mem.inst.opcode == OP_JAL || s.ex_mem.inst.opcode == OP_JALR)
+	{
+		}
+	else
+		s.mem_wb.ALUresult = s.ex_mem.ALUresult;
+
+	// Setting the control signals
+	s.mem_wb.inst = s.ex_mem.inst;
+	s.mem_wb.PCnext = s.ex_mem.PCnext;
+	// s.mem_wb.MemRead= s.ex_mem.MemRead;
+
+	s.mem_wb.writeRegister = s.ex_mem.writeRegister;
+	s.mem_wb.rd = s.ex_mem.rd;
+
+	s.mem_wb.nop = false;
+
+	return 0;
+}
+
+// ---------------------------- Writeback stage ----------------------------
+template <ForwardingPolicy Forwarding>
+int WB(struct RISCV_Architecture *arch, state &s)
+{
+	// If the previous stage is a nop, then this stage is a nop
+	if (s.mem_wb.nop)
+	{
+		s.mem_wb.inst = Instruction();
+		return 0;
+	}
+	if (Forwarding == NO_FORWARDING)
+		std :: cout << arch->mnemonic(s.mem_wb.inst) <<  "I was in WB "<< "\n";
+	// if writeRegister is true, then write the value to the register
+	if (s.mem_wb.writeRegister)
+	{
+		int r = s.mem_wb.rd;
+		int value = s.mem_wb.ALUresult;
+
+		if (r < 0)
+			return 1;
+
+		arch->registers[r] = value;
+	}
+
+	return 0;
+}
+
+// ---------------------------- Execute commands ----------------------------
+template <ForwardingPolicy Forwarding, BranchResolution Branch>
+void executeCommandsPipelined(struct RISCV_Architecture *arch, int cycleCount, std::ofstream &outputFile)
+{
+	 // Initialize the variables
+	 int clockCycles = 0;
+	 state s{}; // Value-initialised, no latch field starts out as garbage
+	 s.to_fetch = true;
+	 s.if_id.nop = false;
+	 s.id_ex.nop = true;
+	 s.ex_mem.nop = true;
+	 s.mem_wb.nop = true;
+
+	 // Pipeline diagram, written out instruction by instruction as they leave the pipeline
+	 PipelineTrace trace(arch->commands, outputFile);
+
+	int if_index = -1, id_index = 0, ex_index = -1, mem_index = -1, wb_index = -1;
+
+	 // While the program is not finished, keep executing commands
+	 while ((arch->PCcurr < arch->commands.size()) || !(s.if_id.nop && s.id_ex.nop && s.ex_mem.nop && s.mem_wb.nop))
+	 {
+
+        if(clockCycles > cycleCount){
+			break;
+		}
+
+
+		 ++clockCycles;
+		 std::cout << "\nClock Cycle: " << clockCycles << "\n";
+		 std::cout << arch->PCcurr << "\n";
+		 std::cout << arch->PCnext << "\n";
+
+		 // Write Back Stage
+		 if (!s.mem_wb.nop)
+		 {
+			 wb_index = s.mem_wb.PCnext;
+			 trace.mark(wb_index, STAGE_WB);
+		 }
+        std :: cout << "WB" << "\n";
+		 // Memory Stage
+		 if (!s.ex_mem.nop)
+		 {
+			 mem_index = s.ex_mem.PCnext;
+			 trace.mark(mem_index, STAGE_MEM);
+		 }
+		std :: cout << "MEM" << "\n";
+		 // Execute Stage
+		 if (!s.id_ex.nop)
+		 {
+			 ex_index = s.id_ex.PCnext;
+			 trace.mark(ex_index, STAGE_EX);
+		 }
+        std :: cout << "EX" << "\n";
+		 // Decode Stage
+		 if (!s.if_id.nop)
+			{
+				id_index = s.if_id.PCnext;
+				trace.mark(id_index, STAGE_ID);
+			}
+        std :: cout << "ID" << "\n";
+		 // Fetch Stage
+		 if (s.to_fetch && arch->PCcurr < arch->commands.size())
+		 {
+			 if_index = arch->PCcurr;
+			 trace.mark(if_index, STAGE_IF);
+		 }
+		 // The diagram covers cycles 1 to cycleCount
+		 if (clockCycles <= cycleCount)
+			 trace.endCycle(clockCycles);
+
+
+		 // Execute pipeline stages in reverse order
+		 WB<Forwarding>(arch, s);  // Write Back
+		 MEM<Forwarding>(arch, s); // Memory Access
+		 EX<Forwarding>(arch, s);  // Execute
+		 ID<Forwarding, Branch>(arch, s);  // Instruction Decode
+		 IF<Forwarding, Branch>(arch, s);  // Instruction Fetch
+         s.to_fetch = true;
+		 // Print the current state of registers after each cycle
+		// arch->printRegisters();
+
+		 arch->PCcurr = arch->PCnext;
+	 }
+
+	 // Write the instructions still in the pipeline
+	 trace.finish();
+
+	 // Handle successful execution
+	 arch->handleExit(arch->SUCCESS, clockCycles);
+}
+
+// ---------------------------- Main ----------------------------
+// Runs fileName for cycleCount cycles and writes outputfiles/<file name><suffix>
+template <ForwardingPolicy Forwarding, BranchResolution Branch>
+int runPipelined(const std::string &fileName, int cycleCount, const std::string &suffix)
+{
+    // Platform-independent directory creation
+    #if defined(__APPLE__)
+        // macOS specific filesystem namespace
+        std::__fs::filesystem::create_directory("outputfiles");
+    #elif __has_include(<filesystem>)
+        // Standard C++17 filesystem
+        std::filesystem::create_directory("outputfiles");
+    #elif __has_include(<experimental/filesystem>)
+        // Experimental filesystem (pre-C++17)
+        std::experimental::filesystem::create_directory("outputfiles");
+    #else
+        // Fallback using system command
+        system("mkdir -p outputfiles");
+    #endif
+
+    // Extract base filename without extension
+    size_t lastSlash = fileName.find_last_of("/\\");
+    std::string baseName = (lastSlash == std::string::npos) ? fileName : fileName.substr(lastSlash + 1);
+    size_t dotPos = baseName.find_last_of(".");
+    if (dotPos != std::string::npos) {
+        baseName = baseName.substr(0, dotPos);
+    }
+
+    // Create output filename
+    std::string outputFileName = "outputfiles/" + baseName + suffix;
+
+    // Open output file
+    std::ofstream outFile(outputFileName);
+    if (!outFile.is_open()) {
+        std::cerr << "Error: Could not open output file " << outputFileName << std::endl;
+        return 1;
+    }
+
+    RISCV_Architecture *riscv = new RISCV_Architecture(fileName);
+    executeCommandsPipelined<Forwarding, Branch>(riscv, cycleCount, outFile);
+    outFile.close();
+
+    std::cout << "Output written to " << outputFileName << std::endl;
+    return 0;
+}
+
+// Runs <file name> for <cycle count> cycles and writes outputfiles/<file name><suffix>
+template <ForwardingPolicy Forwarding, BranchResolution Branch>
+int runPipelined(int argc, char *argv[], const std::string &binaryName, const std::string &suffix)
+{
+    if (argc != 3)
+    {
+        std::cerr << "Required arguments: file_name cycle_count\n" << binaryName << " <file name> <cycle count>\n";
+        return 0;
+    }
+    return runPipelined<Forwarding, Branch>(argv[1], std::stoi(argv[2]), suffix);
+}
+
+ #endif
@@ -107,6 +107,73 @@ void RISCV_Architecture::constructCommands(const std::string &fileName)
     commandCount.assign(commands.size(), 0);
 }
 
+int RISCV_Architecture::registerIndex(const std::string &r) const
+{
+    if (r.empty())
+        return NO_REGISTER;
+    auto it = registerMap.find(r);
+    return it == registerMap.end() ? NOT_A_REGISTER : it->second;
+}
+
+// Decode every command once, the stages then work on opcodes, register indices and immediates
+void RISCV_Architecture::decodeCommands()
+{
+    static const std::unordered_map<std::string, Opcode> opcodes = {
+        {"add", OP_ADD}, {"sub", OP_SUB}, {"mul", OP_MUL}, {"slt", OP_SLT}, {"sll", OP_SLL},
+        {"addi", OP_ADDI}, {"slli", OP_SLLI},
+        {"lw", OP_LW}, {"sw", OP_SW}, {"lb", OP_LB}, {"sb", OP_SB},
+        {"beq", OP_BEQ}, {"bne", OP_BNE}, {"bge", OP_BGE}, {"bgt", OP_BGT},
+        {"jal", OP_JAL}, {"jalr", OP_JALR}};
+
+    instructions.assign(commands.size(), Instruction());
+    for (size_t i = 0; i < commands.size(); ++i)
+    {
+        const std::vector<std::string> &command = commands[i];
+        Instruction &inst = instructions[i];
+        auto op = opcodes.find(command[0]);
+        inst.opcode = command[0].empty() ? OP_NONE : (op == opcodes.end() ? OP_UNKNOWN : op->second);
+        inst.index = i;
+        inst.rd = registerIndex(command[1]);
+        inst.rs = registerIndex(command[2]);
+        inst.rt = registerIndex(command[3]);
+
+        switch (inst.opcode)
+        {
+        case OP_ADDI:
+        case OP_SLLI:
+            inst.imm = std::stoi(command[3]);
+            break;
+
+        case OP_JAL:
+            inst.imm = std::stoi(command[2]); // Offset is in rs (2nd operand)
+            break;
+
+        case OP_LW:
+        case OP_SW:
+        case OP_LB:
+        case OP_SB:
+        case OP_JALR:
+        {
+            // Separating register from offset
+            const std::string &location = command[2];
+            int lparen = location.find('(');
+            inst.imm = std::stoi(lparen == 0 ? "0" : location.substr(0, lparen));
+            inst.rt = registerIndex(location.substr(lparen + 1, location.length() - lparen - 2));
+        }
+        break;
+
+        default:
+            break;
+        }
+    }
+}
+
+const std::string &RISCV_Architecture::mnemonic(const Instruction &inst) const
+{
+    static const std::string empty;
+    return inst.index < 0 ? empty : commands[inst.index][0];
+}
+
 // Handle exit codes
 void RISCV_Architecture::handleExit(exit_code code, int cycleCount)
 {
@@ -141,3 +208,68 @@ void RISCV_Architecture::handleExit(exit_code code, int cycleCount)
     }
 }
 
+void PipelineTrace::mark(int index, Stage stage)
+{
+    if (index < 0 || index >= (int)commands.size())
+        return;
+    for (auto &m : marks)
+        if (m.first == index)
+        {
+            m.second = stage;
+            return;
+        }
+    marks.push_back({index, stage});
+}
+
+void PipelineTrace::endCycle(int cycle)
+{
+    next.clear();
+    for (const Record &record : open)
+    {
+        auto m = marks.begin();
+        while (m != marks.end() && m->first != record.index)
+            ++m;
+        // Not marked or back in an earlier stage, this instance has left the pipeline
+        if (m == marks.end() || m->second < record.stage)
+        {
+            write(record);
+            continue;
+        }
+        Record advanced = record;
+        if (m->second > advanced.stage)
+            advanced.entry[m->second] = cycle;
+        advanced.stage = m->second;
+        next.push_back(advanced);
+        marks.erase(m);
+    }
+    // Marks left over start new instances
+    for (const auto &m : marks)
+    {
+        Record record{m.first, m.second, {0}};
+        record.entry[m.second] = cycle;
+        next.push_back(record);
+    }
+    open.swap(next);
+    marks.clear();
+}
+
+void PipelineTrace::finish()
+{
+    for (const Record &record : open)
+        write(record);
+    open.clear();
+    marks.clear();
+}
+
+void PipelineTrace::write(const Record &record)
+{
+    const std::vector<std::string> &command = commands[record.index];
+    out << command[0] << " " << command[1] << " " << command[2] << " " << command[3];
+    for (int stage = STAGE_IF; stage < STAGE_COUNT; ++stage)
+    {
+        out << ";";
+        if (record.entry[stage] > 0)
+            out << record.entry[stage];
+    }
+    out << "\n";
+}
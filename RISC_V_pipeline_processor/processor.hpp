@@ -10,6 +10,73 @@
  #include <iostream>
  #include <iomanip> // For std::setw
 
+// Opcodes of the supported instructions, OP_NONE is an empty pipeline slot
+enum Opcode
+{
+    OP_NONE = 0,
+    OP_ADD, OP_SUB, OP_MUL, OP_SLT, OP_SLL,
+    OP_ADDI, OP_SLLI,
+    OP_LW, OP_SW, OP_LB, OP_SB,
+    OP_BEQ, OP_BNE, OP_BGE, OP_BGT,
+    OP_JAL, OP_JALR,
+    OP_UNKNOWN
+};
+
+// Operand values that are not register indices
+const int NO_REGISTER = -1;    // Empty operand
+const int NOT_A_REGISTER = -2; // Immediate, offset(base) or unknown name
+
+// Bit of an operand in a hazard scoreboard mask, registers use bits 0-31 and an empty operand bit 32
+// The stall checks only look at REGISTER_BITS, the bypass checks still let an empty operand match an empty destination
+const unsigned long long REGISTER_BITS = 0xFFFFFFFFull;
+inline unsigned long long registerBit(int r) { return r >= 0 ? 1ull << r : (r == NO_REGISTER ? 1ull << 32 : 0); }
+
+// An instruction decoded once from its command strings, so the pipeline never re-parses text
+struct Instruction
+{
+    Opcode opcode = OP_NONE;
+    int index = -1;          // Position in commands, -1 for an empty slot
+    int rd = NO_REGISTER;    // 1st operand
+    int rs = NO_REGISTER;    // 2nd operand
+    int rt = NO_REGISTER;    // 3rd operand, or the base register of offset(base)
+    int imm = 0;             // Immediate, jump offset or memory offset
+};
+
+
+// Pipeline stages in program order, indexing the stage-entry cycles of a trace record
+enum Stage { STAGE_IF = 0, STAGE_ID, STAGE_EX, STAGE_MEM, STAGE_WB, STAGE_COUNT };
+
+// Streams the pipeline diagram as one record per dynamic instruction instance:
+//     <instruction>;<IF cycle>;<ID cycle>;<EX cycle>;<MEM cycle>;<WB cycle>
+// Every cycle the stages mark the instruction they hold, a later mark of the same instruction in a cycle wins.
+// An instance stays open while its instruction is marked every cycle in a stage no earlier than its last one,
+// it is written out as soon as that stops, so only the instructions in flight are ever held
+class PipelineTrace
+{
+public:
+    PipelineTrace(const std::vector<std::vector<std::string>> &commands, std::ostream &out) : commands(commands), out(out) {}
+
+    void mark(int index, Stage stage); // The instruction at index is in stage this cycle
+    void endCycle(int cycle);          // Apply the marks of cycle, writing out the instances that left
+    void finish();                     // Write out the instances in flight, marks of an unended cycle are dropped
+
+private:
+    struct Record
+    {
+        int index;
+        int stage;                // Furthest stage reached
+        int entry[STAGE_COUNT];   // Cycle the stage was entered, 0 if never
+    };
+
+    void write(const Record &record);
+
+    const std::vector<std::vector<std::string>> &commands;
+    std::ostream &out;
+    std::vector<Record> open;                          // Instances in flight, at most one per stage
+    std::vector<Record> next;                          // Instances still in flight after this cycle, kept to reuse its storage
+    std::vector<std::pair<int, Stage>> marks;          // Marks of the current cycle
+};
+
 
 struct RISCV_Architecture{
 
@@ -20,6 +87,7 @@ struct RISCV_Architecture{
      int data[MAX >> 2] = {0};
     //  std::unordered_map<int, int> memoryDelta;
      std::vector<std::vector<std::string>> commands;
+     std::vector<Instruction> instructions; // commands after decodeCommands
      std::vector<int> commandCount;
 
      enum exit_code
@@ -67,6 +135,8 @@ struct RISCV_Architecture{
     // More temporaries
     for (int i = 3; i < 7; ++i)
         registerMap["t" + std::to_string(i)] = i + 25;
+
+    decodeCommands();
     }
     
      // Constructor
@@ -79,6 +149,16 @@ struct RISCV_Architecture{
      // Parse and construct commands
     void parseCommand(const std::string &line);
     void constructCommands(const std::string &fileName);
+
+     // Decode commands into instructions once the register names are known
+    int registerIndex(const std::string &r) const;
+    void decodeCommands();
+
+     // Register value of a decoded operand, non-registers read x0 like a registerMap miss
+    int readRegister(int r) const { return registers[r < 0 ? 0 : r]; }
+
+     // Opcode text of an instruction for the debug output
+    const std::string &mnemonic(const Instruction &inst) const;
  
      // Handle exit codes
     void handleExit(exit_code code, int cycleCount);
@@ -88,4 +168,4 @@ struct RISCV_Architecture{
 
 };
 
- #endif
\ No newline at end of file
+ #endif
\ No newline at end of file